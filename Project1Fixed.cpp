@@ -1,251 +1,3248 @@
-/*
-  Project1.cpp
-  Evan Lee and Seha Kim
-  Simulate a robot navigating a graph
-  November/08/2024
-*/
-
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <cmath>
-#include <queue>
-#include <tuple>
-#include <set>
-#include <algorithm>
-#include <iomanip>
-#include <unordered_map>
-#include <string>
-
-
-using namespace std;
-
-
-/**
- * @brief               Constant variables
- * @param INPUTFILE     name of input file
- * @param OUTPUTFILE    name of output file
- * @param ROWCOUNT      number of rows (height/y of graph)
- * @param COLCOUNT      number of columns (width/x of graph)
- * @param k             "turning" weight / angle change penalty
- * @param MOVES         vector of vectors in the form {move identifier, x transformation, y transformation}
- * @param map           future map of height ROWCOUNT and width COLCOUNT, initially a set of 0s
-*/ 
-const string INPUTFILE = "input1.txt";
-const string OUTPUTFILE = "output1_k4.txt";
-const int ROWCOUNT = 30;
-const int COLCOUNT = 50;
-const int k = 4;
-const vector<vector<int>> MOVES = {{0, 1, 0}, {1, 1, 1}, {2, 0, 1}, {3, -1, 1}, {4, -1, 0}, 
-                                    {5, -1, -1}, {6, 0, -1}, {7, 1, -1}};
-vector<vector<int>> map(ROWCOUNT, vector<int>(COLCOUNT));
-
-
-/**
- * @brief Node class. Used while A* searching
- */
-
-struct Node {
-    /**
-     * @brief       constructs a Node with given parameters
-     * @param i_x   x position of node
-     * @param i_y   y position of node
-     * @param pCost path cost of node
-     * @param hCost heuristic code of node
-     * @param pNode parent node
-     * @param nMove last move to reach current node (used in calculating "turning" cost)
-     */
-    Node(int i_x, int i_y, double pCost, double hCost, Node* pNode = nullptr, int nMove = -1)
-        : x(i_x), y(i_y), pathCost(pCost), heuristic(hCost), totalCost(pCost + hCost), parent(pNode), moveTo(nMove){}
-
-    int x;
-    int y;
-    double pathCost;
-    double heuristic;
-    double totalCost;
-    Node* parent;
-    int moveTo;
-
-    // overload < operator to allow for node comparison during priority queue in A* search
-    bool operator<(const Node& other) const{
-        return totalCost > other.totalCost;
-    }
-};
-
-
-/**
- * @brief       calculate the heuristic cost from a given x,y to a goal x, y
- * @param n_x   node's x coordinate
- * @param n_y   node's y coordinate
- * @param g_x   goal's x coordinate
- * @param g_y   goal's y coordinate
- */
-double calcHeuristic(int n_x, int n_y, int g_x, int g_y){
-    return sqrt(pow(n_x - g_x, 2) + pow(n_y - g_y, 2));
-}
-
-
-/**
- * @brief           calculate the cost the action cost to move between two given coordinates
- * @param n_x       initial x coordinate
- * @param n_y       initial y coordinate
- * @param g_x       goal x coordinate
- * @param g_y       goal y coordinate
- * @param oldFace   where the robot was "facing" on its initial coordinate
- * @param newFace   where the robot must "face" to move to its goal coordinate
- * @param k         angle change penalty
- */
-double calcMoveCost(int n_x, int n_y, int g_x, int g_y, int oldFace, int newFace, double k){
-    double turnCost = 0.0;
-    if (oldFace != -1){
-        // turnCost = minimum number of 45 degree turns (int jumps) the robot must make to face its new direction.
-        int jumps = ((newFace - oldFace + 8)% 8 > 4) ? (8 - ((newFace - oldFace + 8)% 8)) : ((newFace - oldFace + 8)% 8);
-        turnCost = k * (jumps) / 4;
-    } 
-    double moveCost = (newFace % 2 == 0) ? 1 : sqrt(2);
-    return turnCost + moveCost;
-}
-
-
-/**
- * @brief           performs an A* search along a given graph
- * @param start_x   starting x coordinate of robot
- * @param start_y   starting y coordinate of robot
- * @param goal_x    goal x coordinate of robot
- * @param goal_y    goal y coordinate of robot
- * @param map       graph along which robot moves
- * @param weight    angle change penalty
- * @return          returns a tuple in the form <tree depth, number of nodes generated, 
- *                                              list of moves in the found solution, 
- *                                              f(n) values of nodes along the solution path>
- */
-tuple<int, int, vector<int>, vector<double>> search(int start_x, int start_y, int goal_x, int goal_y, vector<vector<int>>& map, double weight) {
-   priority_queue<Node> frontier;    // Priority queue for open nodes
-   unordered_map<int, bool> visited;    // Set to keep track of visited nodes
-   int nodeCount = 1;
-
-
-   Node* start_node = new Node(start_x, start_y, 0, calcHeuristic(start_x, start_y, goal_x, goal_y), nullptr, -1);
-   frontier.push(*start_node);
-
-
-   while (!frontier.empty()) {
-       Node cur = frontier.top();
-       frontier.pop();
-
-        // checks if robot has reached goal position
-       if ((cur.x == goal_x) && (cur.y == goal_y)) {
-            vector<int> solution;
-            vector<double> costs;
-            int depth = 0;
-
-            //trace back through solution path
-            Node* checkNode = &cur;
-            while (checkNode) {
-                if (checkNode->moveTo != -1){
-                    solution.push_back(checkNode->moveTo);
-                }
-                costs.push_back(checkNode->totalCost);
-                checkNode = checkNode->parent;
-                depth++;
-            }
-
-            reverse(solution.begin(), solution.end());
-            reverse(costs.begin(), costs.end());
-            delete start_node;
-            return{depth, nodeCount, solution, costs};
-
-       }
-
-        // otherwise, expand possible children
-        pair<int, int> position;
-        position.first = cur.x;
-        position.second = cur.y;
-        visited[cur.x + (COLCOUNT * cur.y)] = true;
-
-        // for each possible move, check if a child is possible. If it is, add the child node to the frontier
-        for (vector<int> move : MOVES) {
-            int ni = cur.x + move[1], nj = cur.y + move[2];
-            if (0 <= nj && nj < ROWCOUNT && 0 <= ni && ni < COLCOUNT && (map[ROWCOUNT - nj - 1][ni] != 1)) {
-                if (!visited[ni + (COLCOUNT * nj)]){
-                    Node* childNode = new Node(ni, nj, 
-                        cur.pathCost + calcMoveCost(cur.x, cur.y, ni, nj, cur.moveTo, move[0], k), 
-                        calcHeuristic(ni, nj, goal_x, goal_y), 
-                        new Node(cur), move[0]);
-                frontier.push(*childNode);
-                nodeCount++;
-                }
-            }
-        }
-   }
-
-   delete start_node;
-   return {0, nodeCount, {}, {}};
-}
-
-/**
- * @brief   model A* search along a graph
- * @return  0 on success. Prints output to specified text file
- */
-int main() {
-
-   ifstream inputFile(INPUTFILE);
-   ofstream outputFile(OUTPUTFILE);
-
-   int start_x, start_y, goal_x, goal_y;
-   inputFile >> start_x >> start_y >> goal_x >> goal_y;
-
-
-   // Copy graph to map
-   vector<vector<int>> map(ROWCOUNT, vector<int>(COLCOUNT));
-   for (int i = 0; i < ROWCOUNT; ++i) {
-       for (int j = 0; j < COLCOUNT; ++j) {
-           inputFile >> map[i][j];
-       }
-   }
-
-    int depth, nodes_generated;
-    vector<int> solution;
-    vector<double>costs;
-    // Initialize A* search
-    tie(depth, nodes_generated, solution, costs) = search(start_x, start_y, goal_x, goal_y, map, k);
-
-    // Print solution to output file
-    if (!solution.empty()) {
-            int cur_x = start_x;
-            int cur_y = start_y;
-        for (int move : solution) {
-            int next_x = cur_x, next_y = cur_y;
-            next_x += MOVES[move][1];
-            next_y += MOVES[move][2];
-            if (map[ROWCOUNT - next_y - 1][next_x] == 0){
-                    map[ROWCOUNT - next_y - 1][next_x] = 4;
-            }
-            cur_x = next_x;
-            cur_y = next_y;
-        }
-
-        outputFile << fixed << setprecision(1);
-
-        outputFile << depth << "\n" << nodes_generated << "\n";
-
-        for (int move : solution) outputFile << move << " ";
-        outputFile << "\n";
-
-        for (double cost : costs) outputFile << cost << " ";
-        outputFile << "\n";
-
-        for (vector<int> row : map) {
-            for (int cell : row) outputFile << cell << " ";
-            outputFile << "\n";
-        }
-
-        cout << "Successfully output to " << OUTPUTFILE;
-    } else {
-        cout << "No solution available.\n";
-    }
-
-   return 0;
-}
-
-
+/*
+  Project1.cpp
+  Evan Lee and Seha Kim
+  Simulate a robot navigating a graph
+  November/08/2024
+*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <queue>
+#include <tuple>
+#include <set>
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <limits>
+#include <list>
+#include <memory>
+#include <random>
+#include <array>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+
+using namespace std;
+
+
+/**
+ * @brief               Constant variables
+ * @param INPUTFILE     default name of input file
+ * @param OUTPUTFILE    default name of output file
+ * @param ROWCOUNT      number of rows (height/y of graph) for input files whose header has no dimensions
+ * @param COLCOUNT      number of columns (width/x of graph) for input files whose header has no dimensions
+ * @param k             default "turning" weight / angle change penalty
+ * @param MOVES         array of moves in the form {move identifier, x transformation, y transformation}
+*/ 
+const string INPUTFILE = "input1.txt";
+const string OUTPUTFILE = "output1_k4.txt";
+const int ROWCOUNT = 30;
+const int COLCOUNT = 50;
+const int k = 4;
+const int MOVES[8][3] = {{0, 1, 0}, {1, 1, 1}, {2, 0, 1}, {3, -1, 1}, {4, -1, 0}, 
+                         {5, -1, -1}, {6, 0, -1}, {7, 1, -1}};
+
+
+/**
+ * @brief Search counters. Compiled in only when built with -DSEARCH_STATS; otherwise the STAT_* and
+ *        TRACE_EXPANSION macros expand to nothing and the hot paths carry no extra work. Counters are
+ *        per thread, so parallel work on other threads (HPA preprocessing, --batch) is not included
+ */
+struct SearchStats {
+    uint64_t expansions = 0;        // nodes popped from a frontier and expanded
+    uint64_t pushes = 0;            // nodes added to a frontier
+    uint64_t updates = 0;           // open nodes whose key was lowered in place
+    uint64_t stalePops = 0;         // outdated entries popped from a lazy frontier and skipped
+    uint64_t heapPeak = 0;          // largest number of entries held by one frontier
+    uint64_t heuristicEvals = 0;    // calls to the query's heuristic
+};
+
+/**
+ * @brief Binary expansion trace file header, followed by one int32 {x, y} pair per node expanded by
+ *        the A*, JPS, bidirectional and Theta* engines, in expansion order. vis.py replays it as an animation
+ */
+struct TraceFileHeader {
+    char magic[4];              // TRACE_MAGIC
+    int32_t rows;               // number of rows (height/y of graph)
+    int32_t cols;               // number of columns (width/x of graph)
+    int32_t start_x;            // starting x coordinate of robot
+    int32_t start_y;            // starting y coordinate of robot
+    int32_t goal_x;             // goal x coordinate of robot
+    int32_t goal_y;             // goal y coordinate of robot
+};
+const char TRACE_MAGIC[4] = {'T', 'R', 'C', '1'};
+
+thread_local SearchStats searchStats;
+vector<int32_t>* expansionTrace = nullptr;      // x, y of each expanded node while a trace is recorded
+
+#ifdef SEARCH_STATS
+constexpr bool SEARCH_STATS_ENABLED = true;
+#define STAT_ADD(field) (++searchStats.field)
+#define STAT_MAX(field, value) (searchStats.field = max<uint64_t>(searchStats.field, (value)))
+#define TRACE_EXPANSION(x, y) (expansionTrace ? (expansionTrace->push_back(x), expansionTrace->push_back(y)) : void())
+#else
+constexpr bool SEARCH_STATS_ENABLED = false;
+#define STAT_ADD(field) ((void)0)
+#define STAT_MAX(field, value) ((void)0)
+#define TRACE_EXPANSION(x, y) ((void)0)
+#endif
+
+
+/**
+ * @brief Grid class. The map stored as a single contiguous buffer of one byte per cell.
+ *        Rows are kept in file order (top row first) and the map is surrounded by a
+ *        one-cell border of obstacles, so a neighbor of any in-map cell can be read
+ *        without bounds checks. Cells are addressed by their index into the buffer.
+ *
+ *        The buffer is either owned by the grid or is a private mapping of a binary map
+ *        file (see mapBinaryGrid()), in which case the file is searched in place and any
+ *        writes to cells stay local to the process.
+ */
+struct Grid {
+    static constexpr uint8_t OBSTACLE = 1;
+    static constexpr uint8_t PATH = 4;
+
+    int rows = 0;               // number of rows (height/y of graph)
+    int cols = 0;               // number of columns (width/x of graph)
+    int stride = 0;             // bytes per buffer row, cols plus the two border cells
+    int moveOffset[8] = {};     // index offset of each move in MOVES
+    uint8_t* cells = nullptr;   // cell values, including the border
+    size_t cellCount = 0;       // number of cells in the buffer, including the border
+
+    Grid() = default;
+    Grid(const Grid&) = delete;
+    Grid& operator=(const Grid&) = delete;
+    ~Grid() { unmap(); }
+
+    /**
+     * @brief       size the grid and fill it with empty cells inside an obstacle border
+     * @param r     number of rows
+     * @param c     number of columns
+     */
+    void resize(int r, int c) {
+        unmap();
+        setDimensions(r, c);
+        storage.assign(cellCount, OBSTACLE);
+        cells = storage.data();
+        for (int i = 1; i <= r; ++i) {
+            fill(cells + size_t(i) * stride + 1, cells + size_t(i) * stride + 1 + c, 0);
+        }
+    }
+
+    /**
+     * @brief       use a mapped region holding a bordered buffer as the grid's cells
+     * @param r     number of rows
+     * @param c     number of columns
+     * @param base  start of the mapping, released with munmap() when the grid is destroyed
+     * @param size  length of the mapping in bytes
+     * @param data  start of the cell buffer within the mapping
+     */
+    void adopt(int r, int c, void* base, size_t size, uint8_t* data) {
+        unmap();
+        storage.clear();
+        setDimensions(r, c);
+        mapping = base;
+        mappingSize = size;
+        cells = data;
+    }
+
+    bool contains(int x, int y) const { return 0 <= x && x < cols && 0 <= y && y < rows; }
+    int index(int x, int y) const { return (rows - y) * stride + x + 1; }
+    int xOf(int cell) const { return cell % stride - 1; }
+    int yOf(int cell) const { return rows - cell / stride; }
+    bool blocked(int cell) const { return cells[cell] == OBSTACLE; }
+    bool isBorder(int cell) const { return !contains(xOf(cell), yOf(cell)); }
+
+    /**
+     * @brief       access a cell by its position in file order
+     * @param row   row of the cell, 0 being the top row
+     * @param col   column of the cell
+     */
+    uint8_t& at(int row, int col) { return cells[size_t(row + 1) * stride + col + 1]; }
+    uint8_t at(int row, int col) const { return cells[size_t(row + 1) * stride + col + 1]; }
+
+private:
+    vector<uint8_t> storage;    // owned cell buffer, empty when the grid is mapped
+    void* mapping = nullptr;    // mapped binary map file, if any
+    size_t mappingSize = 0;
+
+    void setDimensions(int r, int c) {
+        rows = r;
+        cols = c;
+        stride = c + 2;
+        cellCount = size_t(r + 2) * stride;
+        // y grows upwards while buffer rows grow downwards
+        for (const auto& move : MOVES) moveOffset[move[0]] = move[1] - move[2] * stride;
+    }
+
+    void unmap() {
+        if (mapping) munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+};
+
+
+/**
+ * @brief Binary map file header. The header is followed directly by the grid's bordered
+ *        cell buffer, (rows + 2) * (cols + 2) bytes in file order, so a mapped file can be
+ *        searched without any parsing.
+ */
+struct GridFileHeader {
+    char magic[4];              // GRID_MAGIC
+    int32_t rows;               // number of rows (height/y of graph)
+    int32_t cols;               // number of columns (width/x of graph)
+    int32_t start_x;            // starting x coordinate of robot
+    int32_t start_y;            // starting y coordinate of robot
+    int32_t goal_x;             // goal x coordinate of robot
+    int32_t goal_y;             // goal y coordinate of robot
+    int32_t reserved;           // keeps the cell buffer 8-byte aligned, always 0
+};
+const char GRID_MAGIC[4] = {'G', 'R', 'D', '1'};
+
+
+/**
+ * @brief Indexed binary min-heap. Each id in the heap remembers its position so its key
+ *        can be lowered in place (decrease-key) instead of pushing a duplicate entry.
+ */
+template <typename Key>
+struct IndexedHeap {
+    static constexpr uint32_t NOT_IN_HEAP = UINT32_MAX;
+
+    vector<pair<Key, uint32_t>> entries;    // heap ordered <key, id> pairs
+    vector<uint32_t> pos;                   // position of each id in entries, NOT_IN_HEAP if absent
+
+    bool empty() const { return entries.empty(); }
+    size_t size() const { return entries.size(); }
+    const Key& topKey() const { return entries[0].first; }
+    uint32_t top() const { return entries[0].second; }
+    bool contains(uint32_t id) const { return id < pos.size() && pos[id] != NOT_IN_HEAP; }
+
+    /**
+     * @brief remove every entry. Only the positions of ids currently in the heap are touched
+     */
+    void clear() {
+        for (const pair<Key, uint32_t>& entry : entries) pos[entry.second] = NOT_IN_HEAP;
+        entries.clear();
+    }
+
+    /**
+     * @brief       insert an id, or update its key if it is already in the heap
+     * @param id    id to insert
+     * @param key   priority of the id. Lower keys are popped first
+     */
+    void push(uint32_t id, const Key& key) {
+        if (id >= pos.size()) pos.resize(id + 1, NOT_IN_HEAP);
+        if (pos[id] != NOT_IN_HEAP) {
+            update(id, key);
+            return;
+        }
+        STAT_ADD(pushes);
+        entries.emplace_back(key, id);
+        STAT_MAX(heapPeak, entries.size());
+        pos[id] = entries.size() - 1;
+        siftUp(entries.size() - 1);
+    }
+
+    /**
+     * @brief       change the key of an id already in the heap
+     * @param id    id to update
+     * @param key   new priority of the id
+     */
+    void update(uint32_t id, const Key& key) {
+        STAT_ADD(updates);
+        size_t i = pos[id];
+        bool lowered = key < entries[i].first;
+        entries[i].first = key;
+        if (lowered) siftUp(i);
+        else siftDown(i);
+    }
+
+    /**
+     * @brief   remove and return the id with the lowest key
+     */
+    uint32_t pop() {
+        STAT_ADD(expansions);
+        uint32_t id = entries[0].second;
+        remove(id);
+        return id;
+    }
+
+    /**
+     * @brief       remove an id from anywhere in the heap
+     * @param id    id to remove
+     */
+    void remove(uint32_t id) {
+        size_t i = pos[id];
+        pos[id] = NOT_IN_HEAP;
+        if (i + 1 != entries.size()) {
+            entries[i] = entries.back();
+            pos[entries[i].second] = i;
+            entries.pop_back();
+            siftDown(i);
+            siftUp(i);
+        } else {
+            entries.pop_back();
+        }
+    }
+
+private:
+    void siftUp(size_t i) {
+        while (i > 0) {
+            size_t p = (i - 1) / 2;
+            if (!(entries[i].first < entries[p].first)) break;
+            swapEntries(i, p);
+            i = p;
+        }
+    }
+
+    void siftDown(size_t i) {
+        size_t n = entries.size();
+        while (true) {
+            size_t l = 2 * i + 1, r = l + 1, best = i;
+            if (l < n && entries[l].first < entries[best].first) best = l;
+            if (r < n && entries[r].first < entries[best].first) best = r;
+            if (best == i) break;
+            swapEntries(i, best);
+            i = best;
+        }
+    }
+
+    void swapEntries(size_t a, size_t b) {
+        swap(entries[a], entries[b]);
+        pos[entries[a].second] = a;
+        pos[entries[b].second] = b;
+    }
+};
+
+
+struct DStarLite;
+
+/**
+ * @brief Search arena. Every node generated during an A* search is stored here as a
+ *        struct-of-arrays instead of as a heap-allocated Node. Parent links are 32-bit
+ *        indices into the same arrays, and the vectors keep their capacity between
+ *        queries, so once warmed up a search performs no heap allocations.
+ *
+ *        A search state is a (cell, heading) pair, since the cost of leaving a cell
+ *        depends on the direction the robot entered it. Heading NO_HEADING is only used
+ *        by the start node. Each state owns at most one node: stateNode maps states to
+ *        the node holding their best known g(n), and closed is a bitset over states.
+ */
+struct SearchArena {
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr int HEADINGS = 9;
+    static constexpr int NO_HEADING = 8;
+
+    vector<int> x;                              // x position of node
+    vector<int> y;                              // y position of node
+    vector<double> pathCost;                    // path cost g(n) of node
+    vector<double> totalCost;                   // f(n) = g(n) + h(n) of node
+    vector<uint32_t> parent;                    // arena index of parent node, NO_PARENT for the start
+    vector<int8_t> moveTo;                      // last move to reach node (used in calculating "turning" cost)
+    vector<uint32_t> state;                     // (cell, heading) state of node
+    vector<uint32_t> stateNode;                 // node of each state, NO_NODE if not generated
+    vector<uint64_t> closed;                    // bitset of expanded states
+    IndexedHeap<pair<double, double>> frontier; // open nodes keyed by <f(n), -g(n)>
+    shared_ptr<DStarLite> replanner;            // incremental planner kept between queries for Engine::DSTAR
+    shared_ptr<SearchArena> reverse;            // backward half of Engine::BIDIR, created on first use
+
+    /**
+     * @brief           clear all nodes while keeping allocated capacity. Only states
+     *                  generated by the previous query are cleared
+     * @param cellCount number of cells in the graph being searched
+     */
+    void reset(size_t cellCount) {
+        size_t stateCount = cellCount * HEADINGS;
+        if (stateNode.size() != stateCount) {
+            stateNode.assign(stateCount, NO_NODE);
+            closed.assign((stateCount + 63) / 64, 0);
+        } else {
+            for (uint32_t s : state) {
+                stateNode[s] = NO_NODE;
+                closed[s >> 6] = 0;
+            }
+        }
+        frontier.clear();
+        x.clear();
+        y.clear();
+        pathCost.clear();
+        totalCost.clear();
+        parent.clear();
+        moveTo.clear();
+        state.clear();
+    }
+
+    /**
+     * @brief           state id of a cell and heading
+     * @param cell      cell index into the grid
+     * @param heading   move used to enter the cell, -1 for none
+     */
+    static uint32_t stateOf(int cell, int heading) {
+        return cell * HEADINGS + (heading == -1 ? NO_HEADING : heading);
+    }
+
+    bool isClosed(uint32_t s) const { return (closed[s >> 6] >> (s & 63)) & 1; }
+    void close(uint32_t s) { closed[s >> 6] |= uint64_t(1) << (s & 63); }
+
+    /**
+     * @brief       append a node to the arena and open it on the frontier
+     * @param s     state of node
+     * @param i_x   x position of node
+     * @param i_y   y position of node
+     * @param pCost path cost of node
+     * @param hCost heuristic cost of node
+     * @param pNode arena index of parent node
+     * @param nMove last move to reach current node
+     * @return      arena index of the new node
+     */
+    uint32_t add(uint32_t s, int i_x, int i_y, double pCost, double hCost, uint32_t pNode, int nMove) {
+        uint32_t node = x.size();
+        x.push_back(i_x);
+        y.push_back(i_y);
+        pathCost.push_back(pCost);
+        totalCost.push_back(pCost + hCost);
+        parent.push_back(pNode);
+        moveTo.push_back(nMove);
+        state.push_back(s);
+        stateNode[s] = node;
+        frontier.push(node, {totalCost[node], -pCost});
+        return node;
+    }
+
+    /**
+     * @brief       lower the path cost of an open node that was reached more cheaply
+     * @param node  arena index of node
+     * @param pCost new path cost of node
+     * @param pNode arena index of new parent node
+     */
+    void relax(uint32_t node, double pCost, uint32_t pNode) {
+        totalCost[node] += pCost - pathCost[node];
+        pathCost[node] = pCost;
+        parent[node] = pNode;
+        frontier.update(node, {totalCost[node], -pCost});
+    }
+};
+
+
+/**
+ * @brief       calculate the heuristic cost from a given x,y to a goal x, y
+ * @param n_x   node's x coordinate
+ * @param n_y   node's y coordinate
+ * @param g_x   goal's x coordinate
+ * @param g_y   goal's y coordinate
+ */
+double calcHeuristic(int n_x, int n_y, int g_x, int g_y){
+    double dx = n_x - g_x, dy = n_y - g_y;
+    return sqrt(dx * dx + dy * dy);
+}
+
+
+/**
+ * @brief           calculate the cost of turning from one move's direction to another's
+ * @param oldFace   where the robot is "facing", -1 if it has not moved yet
+ * @param newFace   where the robot must "face" next, -1 if it stops
+ * @param k         angle change penalty
+ */
+double calcTurnCost(int oldFace, int newFace, double k) {
+    if (oldFace == -1 || newFace == -1) return 0.0;
+    // minimum number of 45 degree turns (int jumps) the robot must make to face its new direction.
+    int jumps = ((newFace - oldFace + 8)% 8 > 4) ? (8 - ((newFace - oldFace + 8)% 8)) : ((newFace - oldFace + 8)% 8);
+    return k * (jumps) / 4;
+}
+
+
+/**
+ * @brief           calculate the cost the action cost to move between two given coordinates
+ * @param n_x       initial x coordinate
+ * @param n_y       initial y coordinate
+ * @param g_x       goal x coordinate
+ * @param g_y       goal y coordinate
+ * @param oldFace   where the robot was "facing" on its initial coordinate
+ * @param newFace   where the robot must "face" to move to its goal coordinate
+ * @param k         angle change penalty
+ */
+double calcMoveCost(int n_x, int n_y, int g_x, int g_y, int oldFace, int newFace, double k){
+    double turnCost = calcTurnCost(oldFace, newFace, k);
+    double moveCost = (newFace % 2 == 0) ? 1 : sqrt(2);
+    return turnCost + moveCost;
+}
+
+
+/**
+ * @brief       move identifier of an x, y transformation
+ * @param dx    x transformation, -1, 0 or 1
+ * @param dy    y transformation, -1, 0 or 1
+ * @return      index into MOVES, -1 for no movement
+ */
+int moveIdOf(int dx, int dy) {
+    static const int ids[3][3] = {{5, 4, 3}, {6, -1, 2}, {7, 0, 1}};
+    return ids[dx + 1][dy + 1];
+}
+
+/**
+ * @brief           lower bound on the turning cost left between a node and the goal. Unless the goal lies
+ *                  on the ray the robot is facing along, at least one 45 degree turn is still needed
+ * @param n_x       node's x coordinate
+ * @param n_y       node's y coordinate
+ * @param g_x       goal's x coordinate
+ * @param g_y       goal's y coordinate
+ * @param heading   last move to reach the node, -1 if the robot has not moved yet
+ * @param k         angle change penalty
+ */
+double calcTurnBound(int n_x, int n_y, int g_x, int g_y, int heading, double k) {
+    int dx = g_x - n_x, dy = g_y - n_y;
+    if (dx == 0 && dy == 0) return 0;
+    if (dx == 0 || dy == 0 || abs(dx) == abs(dy)) {
+        int towardGoal = moveIdOf((dx > 0) - (dx < 0), (dy > 0) - (dy < 0));
+        if (heading == -1 || heading == towardGoal) return 0;
+    }
+    return k / 4;
+}
+
+/**
+ * @brief           calculate the octile distance from a given x,y to a goal x,y plus the turning lower
+ *                  bound of calcTurnBound(). Admissible and consistent for the calcMoveCost() cost model
+ * @param n_x       node's x coordinate
+ * @param n_y       node's y coordinate
+ * @param g_x       goal's x coordinate
+ * @param g_y       goal's y coordinate
+ * @param heading   last move to reach the node, -1 if the robot has not moved yet
+ * @param k         angle change penalty
+ */
+double calcOctileHeuristic(int n_x, int n_y, int g_x, int g_y, int heading, double k) {
+    int dx = abs(n_x - g_x), dy = abs(n_y - g_y);
+    return max(dx, dy) + (sqrt(2) - 1) * min(dx, dy) + calcTurnBound(n_x, n_y, g_x, g_y, heading, k);
+}
+
+/**
+ * @brief           build a table of the cheapest turn-free cost from every cell to a goal, around
+ *                  obstacles, with a reverse Dijkstra search from the goal
+ * @param grid      graph along which robot moves
+ * @param goal_x    goal x coordinate of robot
+ * @param goal_y    goal y coordinate of robot
+ * @return          distances indexed by cell. Cells that cannot reach the goal hold infinity
+ */
+vector<double> buildGoalDistances(const Grid& grid, int goal_x, int goal_y) {
+    vector<double> distance(grid.cellCount, numeric_limits<double>::infinity());
+    priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> frontier;
+    int goalCell = grid.index(goal_x, goal_y);
+    distance[goalCell] = 0;
+    frontier.emplace(0, goalCell);
+
+    while (!frontier.empty()) {
+        double cost = frontier.top().first;
+        int cell = frontier.top().second;
+        frontier.pop();
+        if (cost > distance[cell]) {
+            STAT_ADD(stalePops);
+            continue;
+        }
+        STAT_ADD(expansions);
+
+        // moves are reversible, so stepping out from the goal gives each cell's cost to reach it
+        for (const auto& move : MOVES) {
+            int next = cell + grid.moveOffset[move[0]];
+            double nextCost = cost + ((move[0] % 2 == 0) ? 1 : sqrt(2));
+            if (!grid.blocked(next) && nextCost < distance[next]) {
+                distance[next] = nextCost;
+                frontier.emplace(nextCost, next);
+                STAT_ADD(pushes);
+                STAT_MAX(heapPeak, frontier.size());
+            }
+        }
+    }
+    return distance;
+}
+
+/**
+ * @brief Goal distance tables kept between queries, so repeated queries to the same goal on the same
+ *        map only pay for buildGoalDistances() once. Holds the most recently used CAPACITY goals and
+ *        may be shared between threads
+ */
+struct HeuristicCache {
+    static constexpr size_t CAPACITY = 16;
+
+    /**
+     * @brief           get the distance table for a goal, building it on first use
+     * @param grid      graph along which robot moves. Must be the same grid for every call
+     * @param goal_x    goal x coordinate of robot
+     * @param goal_y    goal y coordinate of robot
+     */
+    shared_ptr<const vector<double>> get(const Grid& grid, int goal_x, int goal_y) {
+        int goalCell = grid.index(goal_x, goal_y);
+        {
+            lock_guard<mutex> guard(lock);
+            for (auto it = tables.begin(); it != tables.end(); ++it) {
+                if (it->first == goalCell) {
+                    tables.splice(tables.begin(), tables, it);
+                    return it->second;
+                }
+            }
+        }
+
+        // build without holding the lock so other goals can still be served meanwhile
+        auto table = make_shared<const vector<double>>(buildGoalDistances(grid, goal_x, goal_y));
+        lock_guard<mutex> guard(lock);
+        for (const auto& entry : tables) {
+            if (entry.first == goalCell) return entry.second;
+        }
+        tables.emplace_front(goalCell, table);
+        if (tables.size() > CAPACITY) tables.pop_back();
+        return table;
+    }
+
+    /**
+     * @brief forget every table, e.g. after the map has changed
+     */
+    void clear() {
+        lock_guard<mutex> guard(lock);
+        tables.clear();
+    }
+
+private:
+    mutex lock;
+    list<pair<int, shared_ptr<const vector<double>>>> tables;   // <goal cell, table>, most recently used first
+};
+
+/**
+ * @brief Heuristics available to the search engines
+ */
+enum class Heuristic {
+    EUCLIDEAN,  // calcHeuristic()
+    OCTILE,     // calcOctileHeuristic()
+    TABLE,      // goal distance table from buildGoalDistances() plus calcTurnBound()
+};
+
+/**
+ * @brief Heuristic bound to one query's goal, called for every generated node
+ */
+struct GoalHeuristic {
+    Heuristic kind = Heuristic::OCTILE;
+    int goal_x = 0;                                 // goal x coordinate of robot
+    int goal_y = 0;                                 // goal y coordinate of robot
+    double weight = k;                              // angle change penalty
+    shared_ptr<const vector<double>> table;         // goal distances by cell, TABLE only
+
+    /**
+     * @brief           estimate the cost from a node to the goal
+     * @param n_x       node's x coordinate
+     * @param n_y       node's y coordinate
+     * @param cell      node's cell index
+     * @param heading   last move to reach the node, -1 if the robot has not moved yet
+     */
+    double operator()(int n_x, int n_y, int cell, int heading) const {
+        STAT_ADD(heuristicEvals);
+        switch (kind) {
+            case Heuristic::EUCLIDEAN:
+                return calcHeuristic(n_x, n_y, goal_x, goal_y);
+            case Heuristic::TABLE:
+                return (*table)[cell] + calcTurnBound(n_x, n_y, goal_x, goal_y, heading, weight);
+            case Heuristic::OCTILE:
+            default:
+                return calcOctileHeuristic(n_x, n_y, goal_x, goal_y, heading, weight);
+        }
+    }
+};
+
+
+/**
+ * @brief           performs an A* search along a given graph
+ * @param start_x   starting x coordinate of robot
+ * @param start_y   starting y coordinate of robot
+ * @param goal_x    goal x coordinate of robot
+ * @param goal_y    goal y coordinate of robot
+ * @param grid      graph along which robot moves
+ * @param weight    angle change penalty
+ * @param arena     node storage for the search. Reset on entry and reusable across queries
+ * @param heuristic estimate of the remaining cost to the goal
+ * @return          returns a tuple in the form <tree depth, number of nodes generated, 
+ *                                              list of moves in the found solution, 
+ *                                              f(n) values of nodes along the solution path>
+ */
+tuple<int, int, vector<int>, vector<double>> search(int start_x, int start_y, int goal_x, int goal_y, const Grid& grid, double weight,
+                                                    SearchArena& arena, const GoalHeuristic& heuristic) {
+    arena.reset(grid.cellCount);
+    int nodeCount = 1;
+    int startCell = grid.index(start_x, start_y);
+
+    arena.add(SearchArena::stateOf(startCell, -1), start_x, start_y, 0,
+              heuristic(start_x, start_y, startCell, -1), SearchArena::NO_PARENT, -1);
+
+    while (!arena.frontier.empty()) {
+        uint32_t cur = arena.frontier.pop();
+        int cur_x = arena.x[cur], cur_y = arena.y[cur];
+        TRACE_EXPANSION(cur_x, cur_y);
+
+        // checks if robot has reached goal position
+        if ((cur_x == goal_x) && (cur_y == goal_y)) {
+            vector<int> solution;
+            vector<double> costs;
+            int depth = 0;
+
+            //trace back through solution path
+            for (uint32_t checkNode = cur; checkNode != SearchArena::NO_PARENT; checkNode = arena.parent[checkNode]) {
+                if (arena.moveTo[checkNode] != -1){
+                    solution.push_back(arena.moveTo[checkNode]);
+                }
+                costs.push_back(arena.totalCost[checkNode]);
+                depth++;
+            }
+
+            reverse(solution.begin(), solution.end());
+            reverse(costs.begin(), costs.end());
+            return{depth, nodeCount, solution, costs};
+        }
+
+        // otherwise, expand possible children. The heading the robot arrived with is
+        // part of the state, so the same cell may still be expanded facing another way
+        uint32_t curState = arena.state[cur];
+        int curCell = curState / SearchArena::HEADINGS;
+        arena.close(curState);
+
+        // for each possible move, check if a child is possible. A child state that is already
+        // open only has its cost lowered; closed states are never reopened. The grid border
+        // is made of obstacles, so no bounds checks are needed
+        for (const auto& move : MOVES) {
+            int childCell = curCell + grid.moveOffset[move[0]];
+            if (grid.blocked(childCell)) continue;
+
+            uint32_t childState = SearchArena::stateOf(childCell, move[0]);
+            if (arena.isClosed(childState)) continue;
+
+            int ni = cur_x + move[1], nj = cur_y + move[2];
+            double childCost = arena.pathCost[cur] + calcMoveCost(cur_x, cur_y, ni, nj, arena.moveTo[cur], move[0], weight);
+            uint32_t child = arena.stateNode[childState];
+            if (child == SearchArena::NO_NODE) {
+                arena.add(childState, ni, nj, childCost, heuristic(ni, nj, childCell, move[0]), cur, move[0]);
+                nodeCount++;
+            } else if (childCost < arena.pathCost[child]) {
+                arena.relax(child, childCost, cur);
+            }
+        }
+    }
+
+    return {0, nodeCount, {}, {}};
+}
+
+/**
+ * @brief   performs an A* search along a given graph with the octile heuristic, using a shared,
+ *          reused search arena
+ * @return  see search() above
+ */
+tuple<int, int, vector<int>, vector<double>> search(int start_x, int start_y, int goal_x, int goal_y, const Grid& grid, double weight) {
+    thread_local SearchArena arena;
+    GoalHeuristic heuristic;
+    heuristic.goal_x = goal_x;
+    heuristic.goal_y = goal_y;
+    heuristic.weight = weight;
+    return search(start_x, start_y, goal_x, goal_y, grid, weight, arena, heuristic);
+}
+
+/**
+ * @brief       check whether a cell entered with a given move has a forced neighbor: a free cell
+ *              whose only optimal route passes through this cell because an obstacle blocks the
+ *              symmetric route around it
+ * @param grid  graph along which robot moves
+ * @param cell  cell that was entered
+ * @param move  move used to enter the cell
+ */
+bool hasForcedNeighbor(const Grid& grid, int cell, int move) {
+    int dx = MOVES[move][1], dy = MOVES[move][2];
+    auto blocked = [&](int x, int y) { return grid.blocked(cell + grid.moveOffset[moveIdOf(x, y)]); };
+    if (dx != 0 && dy != 0) {
+        return (blocked(-dx, 0) && !blocked(-dx, dy)) || (blocked(0, -dy) && !blocked(dx, -dy));
+    }
+    if (dx != 0) {
+        return (blocked(0, 1) && !blocked(dx, 1)) || (blocked(0, -1) && !blocked(dx, -1));
+    }
+    return (blocked(1, 0) && !blocked(1, dy)) || (blocked(-1, 0) && !blocked(-1, dy));
+}
+
+/**
+ * @brief           list the moves worth trying from a jump point, i.e. its natural and forced neighbors
+ * @param grid      graph along which robot moves
+ * @param cell      jump point
+ * @param move      move used to reach the jump point, -1 for the start (every move is tried)
+ * @param turnAware whether turns are penalized. Paths that only differ in where they turn then cost
+ *                  differently, so a straight heading keeps both 45 degree turns as natural neighbors.
+ *                  Wider turns still never pay off: from a straight heading, and for 135 degrees or more
+ *                  from any heading, one move to the same cell is shorter and turns no more, and a 90
+ *                  degree turn from a diagonal heading only pays off past an obstacle, as a forced neighbor
+ * @param moves     set to the moves to try
+ * @return          number of moves written
+ */
+int prunedMoves(const Grid& grid, int cell, int move, bool turnAware, int moves[8]) {
+    if (move == -1) {
+        for (int i = 0; i < 8; ++i) moves[i] = i;
+        return 8;
+    }
+
+    int dx = MOVES[move][1], dy = MOVES[move][2], count = 0;
+    auto blocked = [&](int x, int y) { return grid.blocked(cell + grid.moveOffset[moveIdOf(x, y)]); };
+    moves[count++] = move;
+    if (dx != 0 && dy != 0) {
+        moves[count++] = moveIdOf(dx, 0);
+        moves[count++] = moveIdOf(0, dy);
+        if (blocked(-dx, 0)) moves[count++] = moveIdOf(-dx, dy);
+        if (blocked(0, -dy)) moves[count++] = moveIdOf(dx, -dy);
+    } else if (turnAware) {
+        moves[count++] = (move + 1) % 8;
+        moves[count++] = (move + 7) % 8;
+    } else if (dx != 0) {
+        if (blocked(0, 1)) moves[count++] = moveIdOf(dx, 1);
+        if (blocked(0, -1)) moves[count++] = moveIdOf(dx, -1);
+    } else {
+        if (blocked(1, 0)) moves[count++] = moveIdOf(1, dy);
+        if (blocked(-1, 0)) moves[count++] = moveIdOf(-1, dy);
+    }
+    return count;
+}
+
+/**
+ * @brief           travel from a cell in a straight line until reaching a jump point: the goal, a cell
+ *                  with a forced neighbor or, for diagonal moves, a cell from which a straight jump
+ *                  along either component of the move finds a jump point
+ * @param grid      graph along which robot moves
+ * @param cell      cell to jump from
+ * @param move      direction of the jump
+ * @param goalCell  cell of the goal
+ * @param steps     set to the number of moves taken to reach the jump point
+ * @param turnAware whether turns are penalized. Straight moves then also stop at cells from which a
+ *                  diagonal jump 45 degrees to either side finds a jump point, since turning there
+ *                  may be cheaper than turning anywhere else along the run
+ * @return          the jump point, or -1 if an obstacle is hit first
+ */
+int jump(const Grid& grid, int cell, int move, int goalCell, int& steps, bool turnAware = false) {
+    int dx = MOVES[move][1], dy = MOVES[move][2];
+    int offset = grid.moveOffset[move];
+    steps = 0;
+    while (true) {
+        cell += offset;
+        steps++;
+        if (grid.blocked(cell)) return -1;
+        if (cell == goalCell || hasForcedNeighbor(grid, cell, move)) return cell;
+        if (turnAware && (dx == 0 || dy == 0)) {
+            int ignored;
+            if (jump(grid, cell, (move + 1) % 8, goalCell, ignored) != -1 || jump(grid, cell, (move + 7) % 8, goalCell, ignored) != -1) {
+                return cell;
+            }
+        }
+        if (dx != 0 && dy != 0) {
+            int ignored;
+            if (jump(grid, cell, moveIdOf(dx, 0), goalCell, ignored) != -1 || jump(grid, cell, moveIdOf(0, dy), goalCell, ignored) != -1) {
+                return cell;
+            }
+        }
+    }
+}
+
+/**
+ * @brief           performs a Jump Point Search along a given graph. Only jump points are added to the
+ *                  frontier; the straight runs between them are skipped over, and a jump costs the turn
+ *                  from the robot's heading at its jump point plus the length of the run. States are
+ *                  (jump point, heading) pairs as in search(). With a turn penalty, symmetric paths that
+ *                  turn in different places no longer cost the same, so straight runs also stop wherever a
+ *                  45 degree turn may pay off (see prunedMoves() and jump()). --check compares the paths
+ *                  with search()'s
+ * @return          same as search(). Nodes generated counts jump points, and the moves and f(n) values
+ *                  cover every cell along the path
+ */
+tuple<int, int, vector<int>, vector<double>> jumpPointSearch(int start_x, int start_y, int goal_x, int goal_y, const Grid& grid, double weight,
+                                                             SearchArena& arena, const GoalHeuristic& heuristic) {
+    arena.reset(grid.cellCount);
+    int nodeCount = 1;
+    int startCell = grid.index(start_x, start_y);
+    int goalCell = grid.index(goal_x, goal_y);
+
+    arena.add(SearchArena::stateOf(startCell, -1), start_x, start_y, 0,
+              heuristic(start_x, start_y, startCell, -1), SearchArena::NO_PARENT, -1);
+
+    while (!arena.frontier.empty()) {
+        uint32_t cur = arena.frontier.pop();
+        uint32_t curState = arena.state[cur];
+        int curCell = curState / SearchArena::HEADINGS;
+        TRACE_EXPANSION(arena.x[cur], arena.y[cur]);
+
+        if (curCell == goalCell) {
+            // list the jump points along the solution, then walk each run between them
+            vector<uint32_t> jumpPoints;
+            for (uint32_t checkNode = cur; checkNode != SearchArena::NO_PARENT; checkNode = arena.parent[checkNode]) {
+                jumpPoints.push_back(checkNode);
+            }
+            reverse(jumpPoints.begin(), jumpPoints.end());
+
+            vector<int> solution;
+            vector<double> costs = {arena.totalCost[jumpPoints[0]]};
+            int x = start_x, y = start_y, heading = -1;
+            double pathCost = 0;
+            for (size_t i = 1; i < jumpPoints.size(); ++i) {
+                int move = arena.moveTo[jumpPoints[i]];
+                while (x != arena.x[jumpPoints[i]] || y != arena.y[jumpPoints[i]]) {
+                    pathCost += calcMoveCost(x, y, x + MOVES[move][1], y + MOVES[move][2], heading, move, weight);
+                    x += MOVES[move][1];
+                    y += MOVES[move][2];
+                    heading = move;
+                    solution.push_back(move);
+                    costs.push_back(pathCost + heuristic(x, y, grid.index(x, y), heading));
+                }
+            }
+            return {int(costs.size()), nodeCount, solution, costs};
+        }
+
+        arena.close(curState);
+
+        int moves[8];
+        int moveCount = prunedMoves(grid, curCell, arena.moveTo[cur], weight != 0, moves);
+        for (int i = 0; i < moveCount; ++i) {
+            int move = moves[i], steps;
+            int jumpCell = jump(grid, curCell, move, goalCell, steps, weight != 0);
+            if (jumpCell == -1) continue;
+
+            uint32_t childState = SearchArena::stateOf(jumpCell, move);
+            if (arena.isClosed(childState)) continue;
+
+            int ni = arena.x[cur] + MOVES[move][1] * steps, nj = arena.y[cur] + MOVES[move][2] * steps;
+            double stepCost = (move % 2 == 0) ? 1 : sqrt(2);
+            double childCost = arena.pathCost[cur] + calcMoveCost(arena.x[cur], arena.y[cur], ni, nj, arena.moveTo[cur], move, weight)
+                               + stepCost * (steps - 1);
+            uint32_t child = arena.stateNode[childState];
+            if (child == SearchArena::NO_NODE) {
+                arena.add(childState, ni, nj, childCost, heuristic(ni, nj, jumpCell, move), cur, move);
+                nodeCount++;
+            } else if (childCost < arena.pathCost[child]) {
+                arena.relax(child, childCost, cur);
+            }
+        }
+    }
+
+    return {0, nodeCount, {}, {}};
+}
+
+/**
+ * @brief           performs a bidirectional A* search along a given graph. A forward search from the start
+ *                  over the (cell, heading) states of search() meets a backward search from the goal whose
+ *                  states are (cell, heading the robot leaves the cell with), so a backward node's path cost
+ *                  covers every turn after the cell but not the turn made in it. That turn is added when the
+ *                  two halves are joined at a cell. The backward half estimates the cost back to the start
+ *                  with the octile heuristic (Euclidean if chosen; the goal table only serves the forward half),
+ *                  and the search stops once either frontier's lowest f(n) reaches the cheapest join found, so
+ *                  the path has the same cost as search()'s
+ * @param arena     node storage for the forward half. The backward half uses arena.reverse
+ * @param heuristic estimate of the remaining cost to the goal, for the forward half
+ * @return          same as search(). Nodes generated counts both halves, and the f(n) values along the
+ *                  path are those of the forward heuristic
+ */
+tuple<int, int, vector<int>, vector<double>> bidirectionalSearch(int start_x, int start_y, int goal_x, int goal_y, const Grid& grid,
+                                                                 double weight, SearchArena& arena, const GoalHeuristic& heuristic) {
+    if (!arena.reverse) arena.reverse = make_shared<SearchArena>();
+    SearchArena& forward = arena;
+    SearchArena& backward = *arena.reverse;
+    forward.reset(grid.cellCount);
+    backward.reset(grid.cellCount);
+    // a reversed path costs the same with every move turned around, so leaving a cell with a heading is
+    // estimated like arriving there with the opposite heading, searching towards the start
+    auto reverseHeuristic = [&](int n_x, int n_y, int heading) {
+        STAT_ADD(heuristicEvals);
+        if (heuristic.kind == Heuristic::EUCLIDEAN) return calcHeuristic(n_x, n_y, start_x, start_y);
+        return calcOctileHeuristic(n_x, n_y, start_x, start_y, heading == -1 ? -1 : (heading + 4) % 8, weight);
+    };
+
+    // cheapest join found so far, as a forward and a backward node in the same cell
+    double best = numeric_limits<double>::infinity();
+    uint32_t bestForward = SearchArena::NO_NODE, bestBackward = SearchArena::NO_NODE;
+    auto join = [&](uint32_t f, uint32_t b) {
+        double cost = forward.pathCost[f] + calcTurnCost(forward.moveTo[f], backward.moveTo[b], weight) + backward.pathCost[b];
+        if (cost < best) {
+            best = cost;
+            bestForward = f;
+            bestBackward = b;
+        }
+    };
+    // join a node in a cell with every node of the other half in the same cell, whatever their heading
+    auto joinCell = [&](int cell, uint32_t node, bool isForward) {
+        const SearchArena& other = isForward ? backward : forward;
+        for (int heading = 0; heading < SearchArena::HEADINGS; ++heading) {
+            uint32_t match = other.stateNode[cell * SearchArena::HEADINGS + heading];
+            if (match == SearchArena::NO_NODE) continue;
+            if (isForward) join(node, match);
+            else join(match, node);
+        }
+    };
+
+    int nodeCount = 2;
+    int startCell = grid.index(start_x, start_y);
+    int goalCell = grid.index(goal_x, goal_y);
+    // the backward half would otherwise step out of an obstacle the forward half can never enter. As in
+    // search(), a start on the blocked goal has already arrived
+    if (grid.blocked(goalCell) && goalCell != startCell) return {0, 1, {}, {}};
+    backward.add(SearchArena::stateOf(goalCell, -1), goal_x, goal_y, 0, reverseHeuristic(goal_x, goal_y, -1), SearchArena::NO_PARENT, -1);
+    // the goal table has no distance for a blocked start, which the robot may still leave, so bound it by 0
+    double rootEstimate = heuristic(start_x, start_y, startCell, -1);
+    if (isinf(rootEstimate)) rootEstimate = 0;
+    uint32_t root = forward.add(SearchArena::stateOf(startCell, -1), start_x, start_y, 0, rootEstimate, SearchArena::NO_PARENT, -1);
+    joinCell(startCell, root, true);
+
+    // expand the half with the smaller frontier until no unexpanded node can lead to a cheaper join
+    while (!forward.frontier.empty() && !backward.frontier.empty()) {
+        if (!isinf(best) && max(forward.frontier.topKey().first, backward.frontier.topKey().first) >= best) break;
+
+        if (forward.frontier.size() <= backward.frontier.size()) {
+            uint32_t cur = forward.frontier.pop();
+            int cur_x = forward.x[cur], cur_y = forward.y[cur];
+            TRACE_EXPANSION(cur_x, cur_y);
+            uint32_t curState = forward.state[cur];
+            int curCell = curState / SearchArena::HEADINGS;
+            forward.close(curState);
+
+            for (const auto& move : MOVES) {
+                int childCell = curCell + grid.moveOffset[move[0]];
+                if (grid.blocked(childCell)) continue;
+
+                uint32_t childState = SearchArena::stateOf(childCell, move[0]);
+                if (forward.isClosed(childState)) continue;
+
+                int ni = cur_x + move[1], nj = cur_y + move[2];
+                double childCost = forward.pathCost[cur] + calcMoveCost(cur_x, cur_y, ni, nj, forward.moveTo[cur], move[0], weight);
+                uint32_t child = forward.stateNode[childState];
+                if (child == SearchArena::NO_NODE) {
+                    child = forward.add(childState, ni, nj, childCost, heuristic(ni, nj, childCell, move[0]), cur, move[0]);
+                    nodeCount++;
+                } else if (childCost < forward.pathCost[child]) {
+                    forward.relax(child, childCost, cur);
+                } else {
+                    continue;
+                }
+                joinCell(childCell, child, true);
+            }
+        } else {
+            uint32_t cur = backward.frontier.pop();
+            int cur_x = backward.x[cur], cur_y = backward.y[cur];
+            TRACE_EXPANSION(cur_x, cur_y);
+            uint32_t curState = backward.state[cur];
+            int curCell = curState / SearchArena::HEADINGS;
+            backward.close(curState);
+
+            // step back to every cell the robot could have come from, entering this cell with the move taken.
+            // Leaving the cell then needs a turn from that move to the heading already chosen
+            for (const auto& move : MOVES) {
+                int prevCell = curCell - grid.moveOffset[move[0]];
+                if (grid.blocked(prevCell)) continue;
+
+                uint32_t prevState = SearchArena::stateOf(prevCell, move[0]);
+                if (backward.isClosed(prevState)) continue;
+
+                int pi = cur_x - move[1], pj = cur_y - move[2];
+                double prevCost = backward.pathCost[cur] + ((move[0] % 2 == 0) ? 1 : sqrt(2))
+                                  + calcTurnCost(move[0], backward.moveTo[cur], weight);
+                uint32_t prev = backward.stateNode[prevState];
+                if (prev == SearchArena::NO_NODE) {
+                    prev = backward.add(prevState, pi, pj, prevCost, reverseHeuristic(pi, pj, move[0]), cur, move[0]);
+                    nodeCount++;
+                } else if (prevCost < backward.pathCost[prev]) {
+                    backward.relax(prev, prevCost, cur);
+                } else {
+                    continue;
+                }
+                joinCell(prevCell, prev, false);
+            }
+        }
+    }
+
+    if (bestForward == SearchArena::NO_NODE) return {0, nodeCount, {}, {}};
+
+    // moves up to the join from the forward half, then the moves leaving each backward node
+    vector<int> solution;
+    for (uint32_t checkNode = bestForward; forward.moveTo[checkNode] != -1; checkNode = forward.parent[checkNode]) {
+        solution.push_back(forward.moveTo[checkNode]);
+    }
+    reverse(solution.begin(), solution.end());
+    for (uint32_t checkNode = bestBackward; backward.moveTo[checkNode] != -1; checkNode = backward.parent[checkNode]) {
+        solution.push_back(backward.moveTo[checkNode]);
+    }
+
+    vector<double> costs = {heuristic(start_x, start_y, startCell, -1)};
+    int x = start_x, y = start_y, heading = -1;
+    double pathCost = 0;
+    for (int move : solution) {
+        pathCost += calcMoveCost(x, y, x + MOVES[move][1], y + MOVES[move][2], heading, move, weight);
+        x += MOVES[move][1];
+        y += MOVES[move][2];
+        heading = move;
+        costs.push_back(pathCost + heuristic(x, y, grid.index(x, y), heading));
+    }
+    return {int(costs.size()), nodeCount, solution, costs};
+}
+
+/**
+ * @brief           walk the straight line between two cells with Bresenham's algorithm, one move at a time.
+ *                  A diagonal step may pass between two obstacles, as a diagonal move in search() may
+ * @param grid      graph along which robot moves
+ * @param moves     if not null, the moves along the line are appended to it
+ * @return          true if no cell on the line is blocked
+ */
+bool lineOfSight(const Grid& grid, int from_x, int from_y, int to_x, int to_y, vector<int>* moves = nullptr) {
+    int dx = abs(to_x - from_x), dy = abs(to_y - from_y);
+    int sx = (to_x > from_x) - (to_x < from_x), sy = (to_y > from_y) - (to_y < from_y);
+    int err = dx - dy;
+    int x = from_x, y = from_y, cell = grid.index(from_x, from_y);
+    while (x != to_x || y != to_y) {
+        int e2 = 2 * err;
+        int stepX = 0, stepY = 0;
+        if (e2 > -dy) {
+            err -= dy;
+            stepX = sx;
+        }
+        if (e2 < dx) {
+            err += dx;
+            stepY = sy;
+        }
+        int move = moveIdOf(stepX, stepY);
+        x += stepX;
+        y += stepY;
+        cell += grid.moveOffset[move];
+        if (grid.blocked(cell)) return false;
+        if (moves) moves->push_back(move);
+    }
+    return true;
+}
+
+/**
+ * @brief           cost of turning at a node of an any-angle path towards a cell, at the rate of calcMoveCost():
+ *                  k for every 180 degrees
+ * @param arena     arena holding the node and its parent
+ * @param node      node the robot turns at. The start, having no parent, turns for free
+ * @param k         angle change penalty
+ */
+double calcAnyAngleTurnCost(const SearchArena& arena, uint32_t node, int to_x, int to_y, double k) {
+    uint32_t from = arena.parent[node];
+    if (from == SearchArena::NO_PARENT) return 0.0;
+    double ax = arena.x[node] - arena.x[from], ay = arena.y[node] - arena.y[from];
+    double bx = to_x - arena.x[node], by = to_y - arena.y[node];
+    return k * atan2(fabs(ax * by - ay * bx), ax * bx + ay * by) / M_PI;
+}
+
+/**
+ * @brief           performs a Theta* any-angle search along a given graph. Cells are expanded as in search(),
+ *                  but a child whose grandparent can see it is linked straight to the grandparent, so the
+ *                  path is a chain of straight segments between waypoints. A segment costs its Euclidean
+ *                  length plus the turn into it, see calcAnyAngleTurnCost(). States are cells alone and the
+ *                  Euclidean heuristic is always used, so the path is short but not guaranteed optimal
+ * @return          same as search(), with the tree depth counting waypoints. The moves follow each segment
+ *                  as lineOfSight() walks it, and the f(n) values along the path use the any-angle costs
+ */
+tuple<int, int, vector<int>, vector<double>> thetaStarSearch(int start_x, int start_y, int goal_x, int goal_y, const Grid& grid,
+                                                             double weight, SearchArena& arena) {
+    arena.reset(grid.cellCount);
+    int nodeCount = 1;
+    int startCell = grid.index(start_x, start_y);
+    int goalCell = grid.index(goal_x, goal_y);
+    auto heuristic = [&](int n_x, int n_y) {
+        STAT_ADD(heuristicEvals);
+        return calcHeuristic(n_x, n_y, goal_x, goal_y);
+    };
+
+    // headings are taken from the parent links, so moveTo is left unset
+    arena.add(SearchArena::stateOf(startCell, -1), start_x, start_y, 0, heuristic(start_x, start_y), SearchArena::NO_PARENT, -1);
+
+    while (!arena.frontier.empty()) {
+        uint32_t cur = arena.frontier.pop();
+        int cur_x = arena.x[cur], cur_y = arena.y[cur];
+        uint32_t curState = arena.state[cur];
+        int curCell = curState / SearchArena::HEADINGS;
+        TRACE_EXPANSION(cur_x, cur_y);
+
+        if (curCell == goalCell) {
+            vector<uint32_t> waypoints;
+            for (uint32_t checkNode = cur; checkNode != SearchArena::NO_PARENT; checkNode = arena.parent[checkNode]) {
+                waypoints.push_back(checkNode);
+            }
+            reverse(waypoints.begin(), waypoints.end());
+
+            vector<int> solution;
+            vector<double> costs = {arena.totalCost[waypoints[0]]};
+            for (size_t i = 1; i < waypoints.size(); ++i) {
+                uint32_t from = waypoints[i - 1], to = waypoints[i];
+                size_t first = solution.size();
+                lineOfSight(grid, arena.x[from], arena.y[from], arena.x[to], arena.y[to], &solution);
+
+                double segmentStart = arena.pathCost[from] + calcAnyAngleTurnCost(arena, from, arena.x[to], arena.y[to], weight);
+                int x = arena.x[from], y = arena.y[from];
+                for (size_t j = first; j < solution.size(); ++j) {
+                    x += MOVES[solution[j]][1];
+                    y += MOVES[solution[j]][2];
+                    costs.push_back(segmentStart + calcHeuristic(arena.x[from], arena.y[from], x, y) + heuristic(x, y));
+                }
+            }
+            return {int(waypoints.size()), nodeCount, solution, costs};
+        }
+
+        arena.close(curState);
+
+        uint32_t grandparent = arena.parent[cur];
+        for (const auto& move : MOVES) {
+            int childCell = curCell + grid.moveOffset[move[0]];
+            if (grid.blocked(childCell)) continue;
+
+            uint32_t childState = SearchArena::stateOf(childCell, -1);
+            if (arena.isClosed(childState)) continue;
+
+            // the cheaper of the step from this cell and, when visible, the straight segment from its parent
+            int ni = cur_x + move[1], nj = cur_y + move[2];
+            uint32_t parent = cur;
+            double childCost = arena.pathCost[cur] + calcAnyAngleTurnCost(arena, cur, ni, nj, weight) + calcHeuristic(cur_x, cur_y, ni, nj);
+            if (grandparent != SearchArena::NO_PARENT && lineOfSight(grid, arena.x[grandparent], arena.y[grandparent], ni, nj)) {
+                double straightCost = arena.pathCost[grandparent] + calcAnyAngleTurnCost(arena, grandparent, ni, nj, weight)
+                                      + calcHeuristic(arena.x[grandparent], arena.y[grandparent], ni, nj);
+                if (straightCost <= childCost) {
+                    parent = grandparent;
+                    childCost = straightCost;
+                }
+            }
+
+            uint32_t child = arena.stateNode[childState];
+            if (child == SearchArena::NO_NODE) {
+                arena.add(childState, ni, nj, childCost, heuristic(ni, nj), parent, -1);
+                nodeCount++;
+            } else if (childCost < arena.pathCost[child]) {
+                arena.relax(child, childCost, parent);
+            }
+        }
+    }
+
+    return {0, nodeCount, {}, {}};
+}
+
+/**
+ * @brief D* Lite incremental planner. Searches backwards from the goal over the same (cell, heading)
+ *        states as search() and keeps its g and rhs values between calls, so when map cells change or
+ *        the robot moves only the states whose cost-to-goal is affected are repaired. The planner is
+ *        bound to one grid, goal and angle change penalty; the grid must outlive it and every change
+ *        to a cell's blocked state must be reported with cellChanged()
+ *
+ *        Costs are kept as integers in units of 1 / COST_SCALE. Keys are sums of the same move costs
+ *        taken in different orders, and with doubles two keys that are equal in exact arithmetic could
+ *        differ in the last bit and stop the search before the start was consistent
+ */
+struct DStarLite {
+    /**
+     * @brief           prepare a planner. No search happens until the first plan()
+     * @param grid      graph along which robot moves
+     * @param goal_x    goal x coordinate of robot
+     * @param goal_y    goal y coordinate of robot
+     * @param weight    angle change penalty
+     */
+    DStarLite(const Grid& grid, int goal_x, int goal_y, double weight)
+        : grid(grid), goal_x(goal_x), goal_y(goal_y), goalCell(grid.index(goal_x, goal_y)), weight(weight),
+          g(grid.cellCount * SearchArena::HEADINGS, INF), rhs(grid.cellCount * SearchArena::HEADINGS, INF) {
+        for (int heading = 0; heading < SearchArena::HEADINGS; ++heading) {
+            for (int move = 0; move < 8; ++move) {
+                moveCost[heading][move] = stepCost(move)
+                    + llround(calcTurnCost(heading == SearchArena::NO_HEADING ? -1 : heading, move, weight) * COST_SCALE);
+            }
+        }
+    }
+
+    /**
+     * @brief   whether this planner answers queries for the given grid, goal and penalty
+     */
+    bool matches(const Grid& other, int other_goal_x, int other_goal_y, double otherWeight) const {
+        return &grid == &other && grid.cellCount * SearchArena::HEADINGS == g.size() &&
+               goal_x == other_goal_x && goal_y == other_goal_y && weight == otherWeight;
+    }
+
+    /**
+     * @brief       record that a cell switched between blocked and free. Only moves into the cell change
+     *              cost, so the states with such a move are queued for repair by the next plan()
+     * @param cell  cell index of the changed cell
+     */
+    void cellChanged(int cell) {
+        if (startCell == -1) return;
+        for (const auto& move : MOVES) {
+            int from = cell - grid.moveOffset[move[0]];
+            if (grid.isBorder(from)) continue;
+            for (int heading = 0; heading < SearchArena::HEADINGS; ++heading) {
+                updateVertex(from * SearchArena::HEADINGS + heading);
+            }
+        }
+    }
+
+    /**
+     * @brief           find the cheapest path from a start to the goal, reusing the previous search
+     * @param start_x   starting x coordinate of robot
+     * @param start_y   starting y coordinate of robot
+     * @return          same as search(). Nodes generated counts the states queued during this call, and
+     *                  f(n) along the path uses the octile heuristic so it is comparable with search()
+     */
+    tuple<int, int, vector<int>, vector<double>> plan(int start_x, int start_y) {
+        nodeCount = 0;
+        int newStart = grid.index(start_x, start_y);
+        if (startCell == -1) {
+            startCell = newStart;
+            for (int heading = 0; heading < SearchArena::HEADINGS; ++heading) updateVertex(stateOf(goalCell, heading));
+        } else if (newStart != startCell) {
+            // keys already queued were computed from the old start; km keeps them lower bounds
+            km += distance(startCell, newStart);
+            startCell = newStart;
+        }
+
+        uint32_t start = stateOf(startCell, SearchArena::NO_HEADING);
+        computeShortestPath(start);
+        if (g[start] == INF) return {0, nodeCount, {}, {}};
+
+        // follow the cheapest successor from each state until the goal is reached. Every state on the
+        // way is consistent, so g drops with each move; anything else means there is no path to follow
+        vector<int> solution;
+        vector<double> costs = {calcOctileHeuristic(start_x, start_y, goal_x, goal_y, -1, weight)};
+        int x = start_x, y = start_y, cell = startCell, heading = -1;
+        uint32_t cur = start;
+        double pathCost = 0;
+        while (cell != goalCell) {
+            int bestMove = -1;
+            long long bestCost = INF;
+            for (const auto& move : MOVES) {
+                int next = cell + grid.moveOffset[move[0]];
+                long long nextCost = g[stateOf(next, move[0])];
+                if (grid.blocked(next) || nextCost == INF) continue;
+                if (moveCost[cur % SearchArena::HEADINGS][move[0]] + nextCost < bestCost) {
+                    bestCost = moveCost[cur % SearchArena::HEADINGS][move[0]] + nextCost;
+                    bestMove = move[0];
+                }
+            }
+            if (bestMove == -1) break;
+            uint32_t next = stateOf(cell + grid.moveOffset[bestMove], bestMove);
+            if (g[next] >= g[cur]) break;
+
+            pathCost += calcMoveCost(x, y, x + MOVES[bestMove][1], y + MOVES[bestMove][2], heading, bestMove, weight);
+            cell += grid.moveOffset[bestMove];
+            cur = next;
+            x += MOVES[bestMove][1];
+            y += MOVES[bestMove][2];
+            heading = bestMove;
+            solution.push_back(bestMove);
+            costs.push_back(pathCost + calcOctileHeuristic(x, y, goal_x, goal_y, heading, weight));
+        }
+        if (cell != goalCell) return {0, nodeCount, {}, {}};
+        return {int(costs.size()), nodeCount, solution, costs};
+    }
+
+private:
+    static constexpr long long COST_SCALE = 1LL << 30;
+    static constexpr long long INF = numeric_limits<long long>::max();
+
+    const Grid& grid;
+    int goal_x;
+    int goal_y;
+    int goalCell;
+    double weight;
+    vector<long long> g;                            // cost-to-goal of each state as of its last expansion
+    vector<long long> rhs;                          // one-step lookahead of g from each state's successors
+    IndexedHeap<pair<long long, long long>> open;   // inconsistent states keyed by calculateKey()
+    long long moveCost[SearchArena::HEADINGS][8];   // calcMoveCost() of each move from each heading
+    int startCell = -1;                             // cell the robot was at on the last plan()
+    long long km = 0;                               // accumulated start movement, see plan()
+    int nodeCount = 0;
+
+    static uint32_t stateOf(int cell, int heading) { return cell * SearchArena::HEADINGS + heading; }
+
+    static long long stepCost(int move) {
+        return move % 2 == 0 ? COST_SCALE : llround(sqrt(2) * COST_SCALE);
+    }
+
+    // octile distance between two cells, built from the same step costs as moveCost so that it stays a
+    // lower bound on the cost of any path between them
+    long long distance(int a, int b) const {
+        int dx = abs(grid.xOf(a) - grid.xOf(b)), dy = abs(grid.yOf(a) - grid.yOf(b));
+        return max(dx, dy) * stepCost(0) + min(dx, dy) * (stepCost(1) - stepCost(0));
+    }
+
+    pair<long long, long long> calculateKey(uint32_t s) const {
+        long long best = min(g[s], rhs[s]);
+        if (best == INF) return {INF, INF};
+        return {best + distance(startCell, s / SearchArena::HEADINGS) + km, best};
+    }
+
+    // recompute rhs from the successors of a state and queue the state if it is inconsistent. As in
+    // search(), only entering a blocked cell is forbidden, so a robot may start on one
+    void updateVertex(uint32_t s) {
+        int cell = s / SearchArena::HEADINGS, heading = s % SearchArena::HEADINGS;
+        if (cell == goalCell) {
+            rhs[s] = 0;
+        } else {
+            long long best = INF;
+            for (const auto& move : MOVES) {
+                int next = cell + grid.moveOffset[move[0]];
+                long long nextCost = g[stateOf(next, move[0])];
+                if (!grid.blocked(next) && nextCost != INF) best = min(best, moveCost[heading][move[0]] + nextCost);
+            }
+            rhs[s] = best;
+        }
+
+        if (g[s] != rhs[s]) {
+            if (!open.contains(s)) nodeCount++;
+            open.push(s, calculateKey(s));
+        } else if (open.contains(s)) {
+            open.remove(s);
+        }
+    }
+
+    // queue every state with a move into state s: the preceding cell entered with any heading
+    void updatePredecessors(uint32_t s) {
+        int heading = s % SearchArena::HEADINGS;
+        if (heading == SearchArena::NO_HEADING) return;
+        int from = s / SearchArena::HEADINGS - grid.moveOffset[heading];
+        if (grid.isBorder(from)) return;
+        for (int h = 0; h < SearchArena::HEADINGS; ++h) updateVertex(stateOf(from, h));
+    }
+
+    // keys tying with the start's are expanded as well, so every state on a cheapest path from the
+    // start is consistent when this returns and plan() can follow it to the goal
+    void computeShortestPath(uint32_t start) {
+        while (!open.empty() && (!(calculateKey(start) < open.topKey()) || rhs[start] != g[start])) {
+            pair<long long, long long> oldKey = open.topKey();
+            uint32_t u = open.top();
+            pair<long long, long long> newKey = calculateKey(u);
+            if (oldKey < newKey) {
+                open.update(u, newKey);
+                continue;
+            }
+            STAT_ADD(expansions);
+            if (g[u] > rhs[u]) {
+                g[u] = rhs[u];
+                open.remove(u);
+                updatePredecessors(u);
+            } else {
+                g[u] = INF;
+                updateVertex(u);
+                updatePredecessors(u);
+            }
+        }
+    }
+};
+
+/**
+ * @brief               run tasks 0..taskCount-1 on a pool of threads. Each worker starts with a
+ *                      contiguous block of tasks, takes work from the front of its own queue and,
+ *                      once that is empty, steals from the back of the other workers' queues
+ * @param taskCount     number of tasks
+ * @param threadCount   number of workers, including the calling thread
+ * @param task          called as task(worker id, task index). Worker ids are 0..threadCount-1
+ */
+void runWorkStealing(size_t taskCount, int threadCount, const function<void(int, size_t)>& task) {
+    struct WorkQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+    vector<WorkQueue> queues(threadCount);
+    for (size_t i = 0; i < taskCount; ++i) queues[i * threadCount / taskCount].tasks.push_back(i);
+
+    auto worker = [&](int id) {
+        while (true) {
+            size_t next = 0;
+            bool found = false;
+            {
+                lock_guard<mutex> guard(queues[id].lock);
+                if (!queues[id].tasks.empty()) {
+                    next = queues[id].tasks.front();
+                    queues[id].tasks.pop_front();
+                    found = true;
+                }
+            }
+            for (int offset = 1; !found && offset < threadCount; ++offset) {
+                WorkQueue& victim = queues[(id + offset) % threadCount];
+                lock_guard<mutex> guard(victim.lock);
+                if (!victim.tasks.empty()) {
+                    next = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    found = true;
+                }
+            }
+            // no tasks are added once the workers start, so empty queues everywhere means we are done
+            if (!found) return;
+            task(id, next);
+        }
+    };
+
+    vector<thread> threads;
+    for (int id = 1; id < threadCount; ++id) threads.emplace_back(worker, id);
+    worker(0);
+    for (thread& t : threads) t.join();
+}
+
+/**
+ * @brief Hierarchical planner (HPA*). The grid is split into square clusters. Free cell pairs straddling
+ *        a cluster border are grouped into entrances, and each entrance contributes one transition (two
+ *        for long entrances) whose cells become nodes of an abstract graph. Pairs joined by a diagonal move
+ *        form entrances the same way, and so do cluster corners touching diagonally. Nodes of one cluster are
+ *        joined by the cheapest heading-aware path inside the cluster, remembering the first and last
+ *        move so the turn between consecutive abstract edges can be charged with calcMoveCost(). Queries
+ *        search the abstract graph and then refine each abstract edge back into moves.
+ *
+ *        plan() only reads the abstraction and may be called from several threads at once, unless
+ *        cellChanged() has been called since the last plan(): the clusters affected by changed cells
+ *        are rebuilt by the next plan(), which must then not run concurrently with any other call
+ */
+struct HierarchicalPlanner {
+    static constexpr int DEFAULT_CLUSTER_SIZE = 16;
+
+    /**
+     * @brief               build the abstraction of a grid
+     * @param grid          graph along which robot moves. Must outlive the planner
+     * @param weight        angle change penalty
+     * @param threadCount   number of threads clusters are built on
+     * @param clusterSize   width and height of a cluster in cells
+     */
+    HierarchicalPlanner(const Grid& grid, double weight, int threadCount = 1, int clusterSize = DEFAULT_CLUSTER_SIZE)
+        : grid(grid), weight(weight), clusterSize(clusterSize),
+          clusterRows((grid.rows + clusterSize - 1) / clusterSize), clusterCols((grid.cols + clusterSize - 1) / clusterSize),
+          clusters(size_t(clusterRows) * clusterCols) {
+        for (int heading = 0; heading < SearchArena::HEADINGS; ++heading) {
+            for (int move = 0; move < 8; ++move) {
+                moveCost[heading][move] = calcMoveCost(0, 0, 0, 0, heading == SearchArena::NO_HEADING ? -1 : heading, move, weight);
+            }
+        }
+        vector<LocalSearch> scratch(threadCount);
+        runWorkStealing(clusters.size(), threadCount, [&](int worker, size_t cluster) { rebuild(cluster, scratch[worker]); });
+    }
+
+    /**
+     * @brief       record that a cell switched between blocked and free. Its cluster and the clusters
+     *              sharing a border with it are rebuilt by the next plan()
+     * @param cell  cell index of the changed cell
+     */
+    void cellChanged(int cell) {
+        int row = grid.rows - 1 - grid.yOf(cell), col = grid.xOf(cell);
+        dirty.push_back((row / clusterSize) * clusterCols + col / clusterSize);
+    }
+
+    /**
+     * @brief           find a path from a start to a goal through the abstract graph
+     * @param start_x   starting x coordinate of robot
+     * @param start_y   starting y coordinate of robot
+     * @param goal_x    goal x coordinate of robot
+     * @param goal_y    goal y coordinate of robot
+     * @return          same as search(). Nodes generated counts abstract states, and f(n) along the
+     *                  refined path uses the octile heuristic so it is comparable with search()
+     */
+    tuple<int, int, vector<int>, vector<double>> plan(int start_x, int start_y, int goal_x, int goal_y) {
+        refresh();
+        int startCell = grid.index(start_x, start_y), goalCell = grid.index(goal_x, goal_y);
+        int startCluster = clusterOf(startCell), goalCluster = clusterOf(goalCell);
+        LocalSearch local;
+
+        // as in search(), the robot may leave a blocked cell but never enter one
+        if (grid.blocked(goalCell) && goalCell != startCell) return {0, 1, {}, {}};
+
+        // a goal inside the start's cluster is reached directly when a path inside the cluster exists
+        vector<int> solution;
+        if (startCluster == goalCluster) {
+            local.run(*this, clusters[startCluster], startCell);
+            if (local.extract(*this, clusters[startCluster], goalCell, &solution)) {
+                return finish(start_x, start_y, goal_x, goal_y, 1, solution);
+            }
+        }
+
+        // connect the start and goal to the nodes of their clusters for this query only
+        vector<Edge> startEdges, goalEdges;
+        local.run(*this, clusters[startCluster], startCell);
+        connect(local, clusters[startCluster], startEdges, false);
+        local.run(*this, clusters[goalCluster], goalCell);
+        connect(local, clusters[goalCluster], goalEdges, true);
+
+        // a blocked start is never a transition, so its steps into other clusters are added as crossings to
+        // temporary nodes, each joined to the nodes of its cluster and to the goal if it lies there
+        if (grid.blocked(startCell)) {
+            for (int move = 0; move < 8; ++move) {
+                int next = startCell + grid.moveOffset[move];
+                if (grid.blocked(next) || clusterOf(next) == startCluster) continue;
+                Edge step;
+                step.from = startCell;
+                step.to = next;
+                step.cost = stepCost(move);
+                step.firstMove = step.lastMove = move;
+                step.crossing = true;
+                startEdges.push_back(step);
+                if (next == goalCell) continue;
+
+                const Cluster& cluster = clusters[clusterOf(next)];
+                local.run(*this, cluster, next);
+                connect(local, cluster, startEdges, false);
+                Edge edge;
+                if (&cluster == &clusters[goalCluster] && local.extract(*this, cluster, goalCell, nullptr, &edge)) {
+                    edge.from = next;
+                    edge.to = goalCell;
+                    startEdges.push_back(edge);
+                }
+            }
+        }
+
+        // A* over (abstract node, heading) states
+        vector<int> stateCell, stateHeading;
+        vector<double> pathCost;
+        vector<uint32_t> parent;
+        vector<char> closed;
+        vector<Edge> via;
+        unordered_map<int64_t, uint32_t> stateIndex;
+        IndexedHeap<pair<double, double>> frontier;
+        auto open = [&](int cell, int heading, double cost, uint32_t from, const Edge& edge) {
+            int64_t key = int64_t(cell) * SearchArena::HEADINGS + (heading == -1 ? SearchArena::NO_HEADING : heading);
+            auto found = stateIndex.find(key);
+            uint32_t s;
+            if (found == stateIndex.end()) {
+                s = stateCell.size();
+                stateIndex.emplace(key, s);
+                stateCell.push_back(cell);
+                stateHeading.push_back(heading);
+                pathCost.push_back(cost);
+                parent.push_back(from);
+                closed.push_back(false);
+                via.push_back(edge);
+            } else {
+                s = found->second;
+                if (closed[s] || cost >= pathCost[s]) return;
+                pathCost[s] = cost;
+                parent[s] = from;
+                via[s] = edge;
+            }
+            double h = calcOctileHeuristic(grid.xOf(cell), grid.yOf(cell), goal_x, goal_y, heading, weight);
+            frontier.push(s, {cost + h, -cost});
+        };
+
+        open(startCell, -1, 0, SearchArena::NO_PARENT, Edge());
+        while (!frontier.empty()) {
+            uint32_t cur = frontier.pop();
+            closed[cur] = true;
+            int cell = stateCell[cur], heading = stateHeading[cur];
+
+            if (cell == goalCell) {
+                vector<uint32_t> path;
+                for (uint32_t s = cur; s != SearchArena::NO_PARENT; s = parent[s]) path.push_back(s);
+                reverse(path.begin(), path.end());
+
+                // refine each abstract edge into the moves it stands for
+                for (size_t i = 1; i < path.size(); ++i) {
+                    const Edge& edge = via[path[i]];
+                    int from = stateCell[path[i - 1]];
+                    if (edge.crossing) {
+                        solution.push_back(edge.firstMove);
+                        continue;
+                    }
+                    const Cluster& cluster = clusters[clusterOf(from)];
+                    local.run(*this, cluster, from);
+                    local.extract(*this, cluster, stateCell[path[i]], &solution);
+                }
+                return finish(start_x, start_y, goal_x, goal_y, int(stateCell.size()), solution);
+            }
+
+            auto relax = [&](const Edge& edge) {
+                double turn = calcMoveCost(0, 0, 0, 0, heading, edge.firstMove, weight) - stepCost(edge.firstMove);
+                open(edge.to, edge.lastMove, pathCost[cur] + turn + edge.cost, cur, edge);
+            };
+            for (const Edge& edge : startEdges) {
+                if (edge.from == cell) relax(edge);
+            }
+            const Cluster& cluster = clusters[clusterOf(cell)];
+            for (size_t i = 0; i < cluster.nodes.size(); ++i) {
+                if (cluster.nodes[i] != cell) continue;
+                for (const Edge& edge : cluster.edges[i]) relax(edge);
+            }
+            for (const Edge& edge : goalEdges) {
+                if (edge.from == cell) relax(edge);
+            }
+        }
+        return {0, int(stateCell.size()), {}, {}};
+    }
+
+private:
+    /**
+     * @brief abstract edge. Cost covers every move on the edge and the turns between them, but not the
+     *        turn onto the first move, which depends on how the edge's start was reached
+     */
+    struct Edge {
+        int from = -1;          // cell the edge leaves
+        int to = -1;            // cell the edge reaches
+        double cost = 0;        // cost of the path along the edge
+        int8_t firstMove = 0;   // first move along the edge
+        int8_t lastMove = 0;    // last move along the edge, the heading on arrival
+        bool crossing = false;  // single move across a cluster border, otherwise a path inside one cluster
+    };
+
+    /**
+     * @brief rectangle of cells and the abstract nodes inside it
+     */
+    struct Cluster {
+        int row0 = 0, col0 = 0;         // top left cell, in file order
+        int rows = 0, cols = 0;         // size in cells, smaller than clusterSize along the map's far edges
+        vector<int> nodes;              // cells that are abstract nodes
+        vector<vector<Edge>> edges;     // edges leaving each node
+    };
+
+    /**
+     * @brief heading-aware Dijkstra search confined to one cluster
+     */
+    struct LocalSearch {
+        vector<double> cost;    // cost of each local (cell, heading) state
+        vector<int> parent;     // previous local state, -1 for the source
+        vector<char> pending;   // target cells not reached yet
+        vector<char> blocked;   // obstacles of the cluster inside a blocked border
+        int width = 0;
+
+        /**
+         * @brief           find the cheapest path from a cell to other cells in the cluster
+         * @param planner   planner owning the cluster
+         * @param cluster   cluster to search
+         * @param from      cell index of the source, which starts with no heading
+         * @param targets   if given, the search stops once every one of these cells has been reached
+         *                  with its cheapest heading. Otherwise every cell in the cluster is searched
+         */
+        void run(const HierarchicalPlanner& planner, const Cluster& cluster, int from, const vector<int>* targets = nullptr) {
+            const Grid& grid = planner.grid;
+            width = cluster.cols;
+            cost.assign(size_t(cluster.rows) * cluster.cols * SearchArena::HEADINGS, numeric_limits<double>::infinity());
+            parent.assign(cost.size(), -1);
+
+            int remaining = -1;
+            if (targets) {
+                pending.assign(size_t(cluster.rows) * cluster.cols, false);
+                remaining = 0;
+                for (int target : *targets) {
+                    int cell = local(cluster, grid, target);
+                    if (!pending[cell]) remaining++;
+                    pending[cell] = true;
+                }
+            }
+
+            // copy the cluster into a buffer with a blocked border so moves need no bounds checks
+            int stride = cluster.cols + 2;
+            blocked.assign(size_t(cluster.rows + 2) * stride, true);
+            for (int row = 0; row < cluster.rows; ++row) {
+                for (int col = 0; col < cluster.cols; ++col) {
+                    blocked[(row + 1) * stride + col + 1] = grid.at(cluster.row0 + row, cluster.col0 + col) == Grid::OBSTACLE;
+                }
+            }
+            int offset[8];
+            for (const auto& move : MOVES) offset[move[0]] = move[1] - move[2] * stride;
+
+            priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> frontier;
+            int source = local(cluster, grid, from) * SearchArena::HEADINGS + SearchArena::NO_HEADING;
+            cost[source] = 0;
+            frontier.emplace(0, source);
+            while (!frontier.empty() && remaining != 0) {
+                double c = frontier.top().first;
+                int s = frontier.top().second;
+                frontier.pop();
+                if (c > cost[s]) {
+                    STAT_ADD(stalePops);
+                    continue;
+                }
+                STAT_ADD(expansions);
+
+                int cell = s / SearchArena::HEADINGS, heading = s % SearchArena::HEADINGS;
+                if (targets && pending[cell]) {
+                    pending[cell] = false;
+                    remaining--;
+                }
+                int padded = (cell / width + 1) * stride + cell % width + 1;
+                for (int move = 0; move < 8; ++move) {
+                    int nextPadded = padded + offset[move];
+                    if (blocked[nextPadded]) continue;
+
+                    int next = ((nextPadded / stride - 1) * width + nextPadded % stride - 1) * SearchArena::HEADINGS + move;
+                    double nextCost = c + planner.moveCost[heading][move];
+                    if (nextCost < cost[next]) {
+                        cost[next] = nextCost;
+                        parent[next] = s;
+                        frontier.emplace(nextCost, next);
+                        STAT_ADD(pushes);
+                        STAT_MAX(heapPeak, frontier.size());
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief           read the cheapest path found by run() to a cell
+         * @param planner   planner owning the cluster
+         * @param cluster   cluster that was searched
+         * @param to        cell index of the target
+         * @param moves     if given, the moves along the path are appended to it
+         * @param edge      if given, set to the path's cost and first and last moves
+         * @return          false if the target cannot be reached inside the cluster
+         */
+        bool extract(const HierarchicalPlanner& planner, const Cluster& cluster, int to, vector<int>* moves, Edge* edge = nullptr) const {
+            int target = local(cluster, planner.grid, to) * SearchArena::HEADINGS;
+            int best = target + SearchArena::NO_HEADING;
+            for (int heading = 0; heading < 8; ++heading) {
+                if (cost[target + heading] < cost[best]) best = target + heading;
+            }
+            if (cost[best] == numeric_limits<double>::infinity()) return false;
+
+            vector<int> path;
+            for (int s = best; parent[s] != -1; s = parent[s]) path.push_back(s % SearchArena::HEADINGS);
+            reverse(path.begin(), path.end());
+            if (moves) moves->insert(moves->end(), path.begin(), path.end());
+            if (edge && !path.empty()) {
+                edge->cost = cost[best];
+                edge->firstMove = path.front();
+                edge->lastMove = path.back();
+            }
+            return true;
+        }
+
+        static int local(const Cluster& cluster, const Grid& grid, int cell) {
+            int row = grid.rows - 1 - grid.yOf(cell), col = grid.xOf(cell);
+            return (row - cluster.row0) * cluster.cols + (col - cluster.col0);
+        }
+    };
+
+    const Grid& grid;
+    double weight;
+    int clusterSize;
+    int clusterRows;
+    int clusterCols;
+    vector<Cluster> clusters;
+    vector<int> dirty;      // clusters containing cells changed since the last plan()
+    double moveCost[SearchArena::HEADINGS][8];  // calcMoveCost() of each move from each heading
+
+    static double stepCost(int move) { return (move % 2 == 0) ? 1 : sqrt(2); }
+
+    int clusterOf(int cell) const {
+        int row = grid.rows - 1 - grid.yOf(cell), col = grid.xOf(cell);
+        return (row / clusterSize) * clusterCols + col / clusterSize;
+    }
+
+    // rebuild every cluster with a changed cell, plus its neighbors (diagonal ones included, for the
+    // corner transitions) whose shared borders may have changed
+    void refresh() {
+        if (dirty.empty()) return;
+        vector<char> stale(clusters.size(), false);
+        for (int cluster : dirty) {
+            int row = cluster / clusterCols, col = cluster % clusterCols;
+            for (int r = max(0, row - 1); r <= min(clusterRows - 1, row + 1); ++r) {
+                for (int c = max(0, col - 1); c <= min(clusterCols - 1, col + 1); ++c) stale[r * clusterCols + c] = true;
+            }
+        }
+        dirty.clear();
+
+        LocalSearch scratch;
+        for (size_t cluster = 0; cluster < clusters.size(); ++cluster) {
+            if (stale[cluster]) rebuild(cluster, scratch);
+        }
+    }
+
+    /**
+     * @brief               append the transitions across one side of a cluster as crossing edges. The
+     *                      neighbor along the side picks the same cell pairs for its reverse transitions
+     * @param cluster       cluster the edges leave
+     * @param side          straight move that crosses the side, 0, 2, 4 or 6
+     * @param move          move the transitions take: side itself, or a diagonal move next to it that
+     *                      reaches the same neighbor (side + 1 or side + 7)
+     * @param crossings     edges to append to
+     */
+    void addTransitions(const Cluster& cluster, int side, int move, vector<Edge>& crossings) const {
+        int dx = MOVES[side][1], dy = MOVES[side][2];
+        bool vertical = (dx == 0);
+        // the cells along the side, and the step from one to the next
+        int row = (dy > 0) ? cluster.row0 : cluster.row0 + cluster.rows - 1;
+        int col = (dx > 0) ? cluster.col0 + cluster.cols - 1 : cluster.col0;
+        if (vertical) col = cluster.col0;
+        else row = cluster.row0;
+        int length = vertical ? cluster.cols : cluster.rows;
+        if ((dy > 0 && row == 0) || (dy < 0 && row == grid.rows - 1) || (dx < 0 && col == 0) || (dx > 0 && col == grid.cols - 1)) return;
+
+        // a move from the i-th cell of the side reaches the (i + shift)-th cell of the neighbor's side.
+        // Pairs reaching past the end of the side lead to a diagonal cluster, see addCornerTransitions()
+        int shift = vertical ? MOVES[move][1] : -MOVES[move][2];
+        auto pairOpen = [&](int i, int crossing) {
+            int r = vertical ? row : row + i, c = vertical ? col + i : col;
+            return grid.at(r, c) != Grid::OBSTACLE && grid.at(r - MOVES[crossing][2], c + MOVES[crossing][1]) != Grid::OBSTACLE;
+        };
+        auto open = [&](int i) { return i + shift >= 0 && i + shift < length && pairOpen(i, move); };
+        auto add = [&](int i) {
+            int r = vertical ? row : row + i, c = vertical ? col + i : col;
+            Edge edge;
+            edge.from = (r + 1) * grid.stride + c + 1;
+            edge.to = edge.from + grid.moveOffset[move];
+            edge.cost = stepCost(move);
+            edge.firstMove = edge.lastMove = move;
+            edge.crossing = true;
+            crossings.push_back(edge);
+        };
+
+        // each maximal run of open pairs is an entrance: short ones get a transition in the middle,
+        // long ones one at each end
+        for (int i = 0; i < length;) {
+            if (!open(i)) {
+                ++i;
+                continue;
+            }
+            int end = i;
+            while (end < length && open(end)) ++end;
+
+            // a diagonal entrance is redundant when a straight pair joins cells of the same run on both sides,
+            // since the cells of a run are neighbors inside their clusters
+            bool redundant = false;
+            for (int k = max(i, i + shift); move != side && k < min(end, end + shift); ++k) redundant |= pairOpen(k, side);
+            if (redundant) {
+                i = end;
+                continue;
+            }
+            if (end - i < 6) {
+                add((i + end - 1) / 2);
+            } else {
+                add(i);
+                add(end - 1);
+            }
+            i = end;
+        }
+    }
+
+    /**
+     * @brief               append a crossing edge for each corner of a cluster from which a diagonal move
+     *                      reaches the corner of the diagonal neighbor
+     * @param cluster       cluster the edges leave
+     * @param crossings     edges to append to
+     */
+    void addCornerTransitions(const Cluster& cluster, vector<Edge>& crossings) const {
+        for (int move : {1, 3, 5, 7}) {
+            int dx = MOVES[move][1], dy = MOVES[move][2];
+            int row = (dy > 0) ? cluster.row0 : cluster.row0 + cluster.rows - 1;
+            int col = (dx > 0) ? cluster.col0 + cluster.cols - 1 : cluster.col0;
+            if (row - dy < 0 || row - dy >= grid.rows || col + dx < 0 || col + dx >= grid.cols) continue;
+            if (grid.at(row, col) == Grid::OBSTACLE || grid.at(row - dy, col + dx) == Grid::OBSTACLE) continue;
+
+            Edge edge;
+            edge.from = (row + 1) * grid.stride + col + 1;
+            edge.to = edge.from + grid.moveOffset[move];
+            edge.cost = stepCost(move);
+            edge.firstMove = edge.lastMove = move;
+            edge.crossing = true;
+            crossings.push_back(edge);
+        }
+    }
+
+    /**
+     * @brief           recompute a cluster's nodes and edges from the grid
+     * @param index     index of the cluster
+     * @param scratch   local search storage
+     */
+    void rebuild(size_t index, LocalSearch& scratch) {
+        Cluster& cluster = clusters[index];
+        cluster.row0 = int(index / clusterCols) * clusterSize;
+        cluster.col0 = int(index % clusterCols) * clusterSize;
+        cluster.rows = min(clusterSize, grid.rows - cluster.row0);
+        cluster.cols = min(clusterSize, grid.cols - cluster.col0);
+
+        vector<Edge> crossings;
+        for (int side : {0, 2, 4, 6}) {
+            for (int move : {side, (side + 1) % 8, (side + 7) % 8}) addTransitions(cluster, side, move, crossings);
+        }
+        addCornerTransitions(cluster, crossings);
+
+        cluster.nodes.clear();
+        for (const Edge& edge : crossings) {
+            if (find(cluster.nodes.begin(), cluster.nodes.end(), edge.from) == cluster.nodes.end()) cluster.nodes.push_back(edge.from);
+        }
+        cluster.edges.assign(cluster.nodes.size(), {});
+        for (const Edge& edge : crossings) {
+            size_t i = find(cluster.nodes.begin(), cluster.nodes.end(), edge.from) - cluster.nodes.begin();
+            cluster.edges[i].push_back(edge);
+        }
+
+        // paths are reversible, so each pair of nodes is searched once and the reverse edge is the same
+        // path run backwards with each move flipped
+        vector<int> targets;
+        for (size_t i = 0; i < cluster.nodes.size(); ++i) {
+            targets.assign(cluster.nodes.begin() + i + 1, cluster.nodes.end());
+            if (targets.empty()) break;
+            scratch.run(*this, cluster, cluster.nodes[i], &targets);
+            for (size_t j = i + 1; j < cluster.nodes.size(); ++j) {
+                Edge edge;
+                if (!scratch.extract(*this, cluster, cluster.nodes[j], nullptr, &edge)) continue;
+                edge.from = cluster.nodes[i];
+                edge.to = cluster.nodes[j];
+                cluster.edges[i].push_back(edge);
+                cluster.edges[j].push_back(reversed(edge));
+            }
+        }
+    }
+
+    // the same path as an edge, travelled in the opposite direction
+    static Edge reversed(const Edge& edge) {
+        Edge back = edge;
+        back.from = edge.to;
+        back.to = edge.from;
+        back.firstMove = (edge.lastMove + 4) % 8;
+        back.lastMove = (edge.firstMove + 4) % 8;
+        return back;
+    }
+
+    /**
+     * @brief               turn a local search from the start or goal into edges to the cluster's nodes
+     * @param local         search run from the start or goal
+     * @param cluster       cluster that was searched
+     * @param edges         edges to fill
+     * @param towardSource  false for edges leaving the source (the start), true for edges arriving at it
+     *                      (the goal), which are the found paths reversed
+     */
+    void connect(const LocalSearch& local, const Cluster& cluster, vector<Edge>& edges, bool towardSource) const {
+        int source = -1;
+        for (int s = 0; s < int(local.parent.size()); ++s) {
+            if (local.cost[s] == 0 && s % SearchArena::HEADINGS == SearchArena::NO_HEADING) source = s / SearchArena::HEADINGS;
+        }
+        int sourceCell = (cluster.row0 + source / cluster.cols + 1) * grid.stride + cluster.col0 + source % cluster.cols + 1;
+
+        for (int node : cluster.nodes) {
+            Edge edge;
+            if (node == sourceCell || !local.extract(*this, cluster, node, nullptr, &edge)) continue;
+            edge.from = sourceCell;
+            edge.to = node;
+            edges.push_back(towardSource ? reversed(edge) : edge);
+        }
+    }
+
+    // walk the refined moves to produce the record search() would
+    tuple<int, int, vector<int>, vector<double>> finish(int start_x, int start_y, int goal_x, int goal_y, int nodeCount,
+                                                        const vector<int>& solution) const {
+        vector<double> costs = {calcOctileHeuristic(start_x, start_y, goal_x, goal_y, -1, weight)};
+        int x = start_x, y = start_y, heading = -1;
+        double pathCost = 0;
+        for (int move : solution) {
+            pathCost += calcMoveCost(x, y, x + MOVES[move][1], y + MOVES[move][2], heading, move, weight);
+            x += MOVES[move][1];
+            y += MOVES[move][2];
+            heading = move;
+            costs.push_back(pathCost + calcOctileHeuristic(x, y, goal_x, goal_y, heading, weight));
+        }
+        return {int(costs.size()), nodeCount, solution, costs};
+    }
+};
+
+/**
+ * @brief Hierarchical planners kept between queries, one per angle change penalty, since the cost of
+ *        every abstract edge depends on the penalty. Queries with a penalty seen before reuse its
+ *        abstraction instead of rebuilding it. Holds the most recently used CAPACITY planners and may be
+ *        shared between threads, with the same restriction on cellChanged() as HierarchicalPlanner
+ */
+struct HierarchyCache {
+    static constexpr size_t CAPACITY = 4;
+
+    /**
+     * @param grid          graph along which robot moves. Must outlive the cache
+     * @param threadCount   number of threads clusters are built on
+     * @param clusterSize   width and height of a cluster in cells
+     */
+    HierarchyCache(const Grid& grid, int threadCount = 1, int clusterSize = HierarchicalPlanner::DEFAULT_CLUSTER_SIZE)
+        : grid(grid), threadCount(threadCount), clusterSize(clusterSize) {}
+
+    /**
+     * @brief           get the planner for a penalty, building it on first use
+     * @param weight    angle change penalty
+     */
+    shared_ptr<HierarchicalPlanner> get(double weight) {
+        {
+            lock_guard<mutex> guard(lock);
+            for (auto it = planners.begin(); it != planners.end(); ++it) {
+                if (it->first == weight) {
+                    planners.splice(planners.begin(), planners, it);
+                    return it->second;
+                }
+            }
+        }
+
+        // build without holding the lock so other penalties can still be served meanwhile
+        auto planner = make_shared<HierarchicalPlanner>(grid, weight, threadCount, clusterSize);
+        lock_guard<mutex> guard(lock);
+        for (const auto& entry : planners) {
+            if (entry.first == weight) return entry.second;
+        }
+        planners.emplace_front(weight, planner);
+        if (planners.size() > CAPACITY) planners.pop_back();
+        return planner;
+    }
+
+    /**
+     * @brief   whether this cache answers queries for the given grid
+     */
+    bool matches(const Grid& other) const {
+        return &grid == &other;
+    }
+
+    /**
+     * @brief       tell every cached planner that a cell switched between blocked and free
+     * @param cell  cell index of the changed cell
+     */
+    void cellChanged(int cell) {
+        lock_guard<mutex> guard(lock);
+        for (auto& entry : planners) entry.second->cellChanged(cell);
+    }
+
+private:
+    const Grid& grid;
+    int threadCount, clusterSize;
+    mutex lock;
+    list<pair<double, shared_ptr<HierarchicalPlanner>>> planners;   // <penalty, planner>, most recently used first
+};
+
+/**
+ * @brief Search engines that can answer a query
+ */
+enum class Engine {
+    ASTAR,      // search(), A* over every cell
+    JPS,        // jumpPointSearch()
+    DSTAR,      // DStarLite, kept between queries to the same goal
+    HPA,        // HierarchicalPlanner
+    BIDIR,      // bidirectionalSearch()
+    THETA,      // thetaStarSearch(), any-angle
+};
+
+/**
+ * @brief Per-query search settings
+ */
+struct SearchOptions {
+    Engine engine = Engine::ASTAR;              // engine used to answer the query
+    double weight = k;                          // angle change penalty
+    Heuristic heuristic = Heuristic::OCTILE;    // estimate of the remaining cost to the goal
+    HeuristicCache* cache = nullptr;            // goal distance tables for Heuristic::TABLE
+    HierarchyCache* hierarchy = nullptr;        // abstractions of the grid for Engine::HPA, built once per map and penalty
+};
+
+/**
+ * @brief           parse an engine name given on the command line
+ * @param name      "astar", "jps", "dstar", "hpa", "bidir" or "theta"
+ * @param engine    set to the named engine
+ * @return          false if the name is unknown
+ */
+bool parseEngine(const string& name, Engine& engine) {
+    if (name == "astar") engine = Engine::ASTAR;
+    else if (name == "jps") engine = Engine::JPS;
+    else if (name == "dstar") engine = Engine::DSTAR;
+    else if (name == "hpa") engine = Engine::HPA;
+    else if (name == "bidir") engine = Engine::BIDIR;
+    else if (name == "theta") engine = Engine::THETA;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief           parse a heuristic name given on the command line
+ * @param name      "euclid", "octile" or "table"
+ * @param heuristic set to the named heuristic
+ * @return          false if the name is unknown
+ */
+bool parseHeuristic(const string& name, Heuristic& heuristic) {
+    if (name == "euclid") heuristic = Heuristic::EUCLIDEAN;
+    else if (name == "octile") heuristic = Heuristic::OCTILE;
+    else if (name == "table") heuristic = Heuristic::TABLE;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief           answer a query with the engine chosen in the options
+ * @return          same as search()
+ */
+tuple<int, int, vector<int>, vector<double>> runSearch(int start_x, int start_y, int goal_x, int goal_y, const Grid& grid,
+                                                       const SearchOptions& options, SearchArena& arena) {
+    GoalHeuristic heuristic;
+    heuristic.kind = options.heuristic;
+    heuristic.goal_x = goal_x;
+    heuristic.goal_y = goal_y;
+    heuristic.weight = options.weight;
+    if (options.heuristic == Heuristic::TABLE) {
+        heuristic.table = options.cache ? options.cache->get(grid, goal_x, goal_y)
+                                        : make_shared<const vector<double>>(buildGoalDistances(grid, goal_x, goal_y));
+    }
+
+    switch (options.engine) {
+        case Engine::JPS:
+            return jumpPointSearch(start_x, start_y, goal_x, goal_y, grid, options.weight, arena, heuristic);
+        case Engine::DSTAR:
+            if (!arena.replanner || !arena.replanner->matches(grid, goal_x, goal_y, options.weight)) {
+                arena.replanner = make_shared<DStarLite>(grid, goal_x, goal_y, options.weight);
+            }
+            return arena.replanner->plan(start_x, start_y);
+        case Engine::HPA:
+            if (options.hierarchy && options.hierarchy->matches(grid)) {
+                return options.hierarchy->get(options.weight)->plan(start_x, start_y, goal_x, goal_y);
+            }
+            return HierarchicalPlanner(grid, options.weight).plan(start_x, start_y, goal_x, goal_y);
+        case Engine::BIDIR:
+            return bidirectionalSearch(start_x, start_y, goal_x, goal_y, grid, options.weight, arena, heuristic);
+        case Engine::THETA:
+            return thetaStarSearch(start_x, start_y, goal_x, goal_y, grid, options.weight, arena);
+        case Engine::ASTAR:
+        default:
+            return search(start_x, start_y, goal_x, goal_y, grid, options.weight, arena, heuristic);
+    }
+}
+
+/**
+ * @brief Chunked text reader. Reads a file in large blocks and parses integers straight
+ *        out of the buffer, avoiding iostream tokenization on very large maps.
+ */
+struct ChunkedReader {
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    /**
+     * @brief           open a file for reading
+     * @param fileName  name of file
+     */
+    explicit ChunkedReader(const string& fileName) : file(fopen(fileName.c_str(), "rb")), buffer(CHUNK_SIZE) {}
+    ~ChunkedReader() { if (file) fclose(file); }
+
+    bool isOpen() const { return file != nullptr; }
+
+    /**
+     * @brief   read the rest of the current line
+     * @return  the line without its line ending
+     */
+    string readLine() {
+        string line;
+        for (int c = get(); c != EOF && c != '\n'; c = get()) {
+            if (c != '\r') line += char(c);
+        }
+        return line;
+    }
+
+    /**
+     * @brief       parse the next whitespace-separated integer
+     * @param value set to the parsed integer
+     * @return      false at end of file or if the next token is not an integer
+     */
+    bool nextInt(int& value) {
+        int c = get();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t') c = get();
+        bool negative = (c == '-');
+        if (negative) c = get();
+        if (c < '0' || c > '9') return false;
+
+        value = 0;
+        while (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            c = get();
+        }
+        if (negative) value = -value;
+        return true;
+    }
+
+private:
+    FILE* file;
+    vector<char> buffer;
+    size_t pos = 0;
+    size_t len = 0;
+
+    int get() {
+        if (pos == len) {
+            len = file ? fread(buffer.data(), 1, buffer.size(), file) : 0;
+            pos = 0;
+            if (len == 0) return EOF;
+        }
+        return (unsigned char)buffer[pos++];
+    }
+};
+
+/**
+ * @brief               read a map in text format. The header is either "start_x start_y goal_x goal_y",
+ *                      in which case the map is ROWCOUNT x COLCOUNT, or "rows cols start_x start_y goal_x goal_y".
+ *                      The header is followed by the rows of the map, top row first
+ * @param fileName      name of input file
+ * @param grid          grid to fill
+ * @param start_x       set to starting x coordinate of robot
+ * @param start_y       set to starting y coordinate of robot
+ * @param goal_x        set to goal x coordinate of robot
+ * @param goal_y        set to goal y coordinate of robot
+ * @return              true on success. Prints the reason to cerr on failure
+ */
+bool readTextMap(const string& fileName, Grid& grid, int& start_x, int& start_y, int& goal_x, int& goal_y) {
+    ChunkedReader inputFile(fileName);
+    if (!inputFile.isOpen()) {
+        cerr << "Could not open " << fileName << "\n";
+        return false;
+    }
+
+    istringstream headerStream(inputFile.readLine());
+    vector<int> fields;
+    for (int field; headerStream >> field;) fields.push_back(field);
+
+    int rows = ROWCOUNT, cols = COLCOUNT;
+    if (fields.size() == 6) {
+        rows = fields[0];
+        cols = fields[1];
+        fields.erase(fields.begin(), fields.begin() + 2);
+    }
+    if (fields.size() != 4 || rows <= 0 || cols <= 0) {
+        cerr << "Malformed header in " << fileName << "\n";
+        return false;
+    }
+    start_x = fields[0];
+    start_y = fields[1];
+    goal_x = fields[2];
+    goal_y = fields[3];
+
+    // Copy graph to grid
+    grid.resize(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        uint8_t* row = &grid.at(i, 0);
+        for (int j = 0; j < cols; ++j) {
+            int cell;
+            if (!inputFile.nextInt(cell)) {
+                cerr << "Map in " << fileName << " is smaller than " << rows << "x" << cols << "\n";
+                return false;
+            }
+            row[j] = cell;
+        }
+    }
+
+    if (!grid.contains(start_x, start_y) || !grid.contains(goal_x, goal_y)) {
+        cerr << "Start or goal lies outside the map\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief               map a binary map file (see GridFileHeader) and use it as the grid in place
+ * @param fileName      name of input file
+ * @param grid          grid to point at the mapped cells
+ * @param start_x       set to starting x coordinate of robot
+ * @param start_y       set to starting y coordinate of robot
+ * @param goal_x        set to goal x coordinate of robot
+ * @param goal_y        set to goal y coordinate of robot
+ * @return              true on success. Prints the reason to cerr on failure
+ */
+bool mapBinaryGrid(const string& fileName, Grid& grid, int& start_x, int& start_y, int& goal_x, int& goal_y) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Could not open " << fileName << "\n";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(GridFileHeader)) {
+        cerr << fileName << " is not a binary map\n";
+        close(fd);
+        return false;
+    }
+
+    // a private writable mapping lets the caller mark the solution path without touching the file
+    size_t size = info.st_size;
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        cerr << "Could not map " << fileName << "\n";
+        return false;
+    }
+
+    GridFileHeader header;
+    memcpy(&header, base, sizeof(header));
+    size_t expected = sizeof(header) + (size_t(header.rows) + 2) * (size_t(header.cols) + 2);
+    if (memcmp(header.magic, GRID_MAGIC, sizeof(GRID_MAGIC)) != 0 || header.rows <= 0 || header.cols <= 0 || size < expected) {
+        cerr << fileName << " is not a binary map\n";
+        munmap(base, size);
+        return false;
+    }
+
+    // the searches rely on the border being solid instead of checking bounds, so never take it on trust
+    const uint8_t* cells = static_cast<const uint8_t*>(base) + sizeof(header);
+    size_t stride = size_t(header.cols) + 2, lastRow = size_t(header.rows) + 1;
+    bool solidBorder = true;
+    for (size_t col = 0; col < stride; ++col) {
+        solidBorder &= cells[col] == Grid::OBSTACLE && cells[lastRow * stride + col] == Grid::OBSTACLE;
+    }
+    for (size_t row = 1; row < lastRow; ++row) {
+        solidBorder &= cells[row * stride] == Grid::OBSTACLE && cells[row * stride + stride - 1] == Grid::OBSTACLE;
+    }
+    if (!solidBorder) {
+        cerr << fileName << " has free cells on its border\n";
+        munmap(base, size);
+        return false;
+    }
+
+    grid.adopt(header.rows, header.cols, base, size, static_cast<uint8_t*>(base) + sizeof(header));
+    start_x = header.start_x;
+    start_y = header.start_y;
+    goal_x = header.goal_x;
+    goal_y = header.goal_y;
+
+    if (!grid.contains(start_x, start_y) || !grid.contains(goal_x, goal_y)) {
+        cerr << "Start or goal lies outside the map\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief               read a map in either format, choosing by the file's leading bytes
+ * @return              see readTextMap() and mapBinaryGrid()
+ */
+bool loadMap(const string& fileName, Grid& grid, int& start_x, int& start_y, int& goal_x, int& goal_y) {
+    char magic[sizeof(GRID_MAGIC)] = {};
+    ifstream probe(fileName, ios::binary);
+    probe.read(magic, sizeof(magic));
+    probe.close();
+
+    if (memcmp(magic, GRID_MAGIC, sizeof(GRID_MAGIC)) == 0) {
+        return mapBinaryGrid(fileName, grid, start_x, start_y, goal_x, goal_y);
+    }
+    return readTextMap(fileName, grid, start_x, start_y, goal_x, goal_y);
+}
+
+/**
+ * @brief               write a grid as a binary map file that mapBinaryGrid() can search in place
+ * @param fileName      name of output file
+ * @param grid          grid to write
+ * @param start_x       starting x coordinate of robot
+ * @param start_y       starting y coordinate of robot
+ * @param goal_x        goal x coordinate of robot
+ * @param goal_y        goal y coordinate of robot
+ * @return              true on success
+ */
+bool writeBinaryGrid(const string& fileName, const Grid& grid, int start_x, int start_y, int goal_x, int goal_y) {
+    GridFileHeader header = {};
+    memcpy(header.magic, GRID_MAGIC, sizeof(GRID_MAGIC));
+    header.rows = grid.rows;
+    header.cols = grid.cols;
+    header.start_x = start_x;
+    header.start_y = start_y;
+    header.goal_x = goal_x;
+    header.goal_y = goal_y;
+
+    ofstream outputFile(fileName, ios::binary);
+    outputFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outputFile.write(reinterpret_cast<const char*>(grid.cells), grid.cellCount);
+    return bool(outputFile);
+}
+
+/**
+ * @brief           write values as space separated runs, straight to the stream. A run of one is written as
+ *                  the value alone, a longer run as "value*length"
+ * @param out       stream to write to. Values that print the same with its formatting belong to the same run
+ * @param values    values to write
+ */
+template <typename T>
+void writeRuns(ostream& out, const vector<T>& values) {
+    ostringstream text;
+    text.copyfmt(out);
+    vector<string> printed(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        text.str("");
+        text << values[i];
+        printed[i] = text.str();
+    }
+
+    for (size_t i = 0; i < printed.size();) {
+        size_t j = i + 1;
+        while (j < printed.size() && printed[j] == printed[i]) ++j;
+        out << printed[i];
+        if (j - i > 1) out << "*" << j - i;
+        out << " ";
+        i = j;
+    }
+}
+
+/**
+ * @brief                   write the result of a search as the four lines main() has always produced:
+ *                          tree depth, nodes generated, moves in the solution and f(n) along the solution
+ * @param out               stream to write to
+ * @param depth             tree depth of solution
+ * @param nodes_generated   number of nodes generated
+ * @param solution          list of moves in the found solution
+ * @param costs             f(n) values of nodes along the solution path
+ * @param runLength         write the moves and f(n) run-length encoded, see writeRuns. f(n) values are
+ *                          compared as printed, to one decimal
+ */
+void writeResult(ostream& out, int depth, int nodes_generated, const vector<int>& solution, const vector<double>& costs,
+                 bool runLength = false) {
+    out << fixed << setprecision(1);
+
+    out << depth << "\n" << nodes_generated << "\n";
+
+    if (runLength) {
+        writeRuns(out, solution);
+        out << "\n";
+        writeRuns(out, costs);
+        out << "\n";
+        return;
+    }
+
+    for (int move : solution) out << move << " ";
+    out << "\n";
+
+    for (double cost : costs) out << cost << " ";
+    out << "\n";
+}
+
+/**
+ * @brief           write the map with the solution marked as Grid::PATH in the text map format, with the
+ *                  "rows cols start_x start_y goal_x goal_y" header that readTextMap() reads. This is the file
+ *                  vis.py draws
+ * @param fileName  name of the map file
+ * @param grid      map searched. Left unchanged
+ * @param solution  list of moves in the found solution
+ * @return          false if the file could not be written
+ */
+bool writeAnnotatedMap(const string& fileName, const Grid& grid, int start_x, int start_y, int goal_x, int goal_y,
+                       const vector<int>& solution) {
+    vector<bool> onPath(grid.cellCount);
+    int cur = grid.index(start_x, start_y);
+    for (int move : solution) {
+        cur += grid.moveOffset[move];
+        onPath[cur] = true;
+    }
+
+    ofstream file(fileName);
+    file << grid.rows << " " << grid.cols << " " << start_x << " " << start_y << " " << goal_x << " " << goal_y << "\n";
+    string line;
+    for (int i = 0; i < grid.rows; ++i) {
+        line.clear();
+        for (int j = 0; j < grid.cols; ++j) {
+            size_t cell = size_t(i + 1) * grid.stride + j + 1;
+            line += to_string(onPath[cell] && grid.cells[cell] == 0 ? Grid::PATH : grid.cells[cell]);
+            line += ' ';
+        }
+        line += '\n';
+        file << line;
+    }
+    return bool(file);
+}
+
+/**
+ * @brief           write the calling thread's search counters as a JSON object
+ */
+void writeSearchStats(ostream& out) {
+    out << "{\"expansions\": " << searchStats.expansions << ", \"pushes\": " << searchStats.pushes
+        << ", \"updates\": " << searchStats.updates << ", \"stale_pops\": " << searchStats.stalePops
+        << ", \"heap_peak\": " << searchStats.heapPeak << ", \"heuristic_evals\": " << searchStats.heuristicEvals << "}";
+}
+
+/**
+ * @brief           write an expansion trace file, see TraceFileHeader
+ * @param fileName  name of the trace file
+ * @param trace     x, y of each expanded node, in expansion order
+ * @return          false if the file could not be written
+ */
+bool writeTrace(const string& fileName, const Grid& grid, int start_x, int start_y, int goal_x, int goal_y, const vector<int32_t>& trace) {
+    ofstream file(fileName, ios::binary);
+    TraceFileHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.rows = grid.rows;
+    header.cols = grid.cols;
+    header.start_x = start_x;
+    header.start_y = start_y;
+    header.goal_x = goal_x;
+    header.goal_y = goal_y;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(trace.data()), trace.size() * sizeof(int32_t));
+    return bool(file);
+}
+
+/**
+ * @brief           answer one query line of the form "start_x start_y goal_x goal_y [k]"
+ * @param line      query to answer
+ * @param grid      graph along which robot moves
+ * @param options   engine and angle change penalty. The query may override the penalty
+ * @param arena     search arena reused between queries
+ * @param out       stream the result record is written to. A malformed query is answered
+ *                  with an empty record (depth 0, no nodes) and the reason is printed to cerr
+ */
+void answerQuery(const string& line, const Grid& grid, const SearchOptions& options, SearchArena& arena, ostream& out) {
+    istringstream query(line);
+    int start_x, start_y, goal_x, goal_y;
+    SearchOptions queryOptions = options;
+    // k is optional, but anything given after the coordinates must be exactly one number
+    string rest;
+    bool malformed = !(query >> start_x >> start_y >> goal_x >> goal_y);
+    if (!malformed && query >> ws && !query.eof()) malformed = !(query >> queryOptions.weight) || (query >> rest);
+    if (malformed) {
+        cerr << "Malformed query: " << line << "\n";
+        writeResult(out, 0, 0, {}, {});
+        return;
+    }
+    if (!grid.contains(start_x, start_y) || !grid.contains(goal_x, goal_y)) {
+        cerr << "Query outside the map: " << line << "\n";
+        writeResult(out, 0, 0, {}, {});
+        return;
+    }
+
+    int depth, nodes_generated;
+    vector<int> solution;
+    vector<double> costs;
+    tie(depth, nodes_generated, solution, costs) = runSearch(start_x, start_y, goal_x, goal_y, grid, queryOptions, arena);
+    writeResult(out, depth, nodes_generated, solution, costs);
+}
+
+/**
+ * @brief           apply a map edit of the form "set x y value" and tell any incremental planner about it
+ * @param line      edit to apply
+ * @param grid      graph along which robot moves
+ * @param options   options whose heuristic cache and hierarchy are told about the edit
+ * @param arena     search arena whose replanner, if any, is told about the edit
+ */
+void applyEdit(const string& line, Grid& grid, const SearchOptions& options, SearchArena& arena) {
+    istringstream edit(line);
+    string command;
+    int x, y, value;
+    if (!(edit >> command >> x >> y >> value) || !grid.contains(x, y) || value < 0 || value > 255) {
+        cerr << "Malformed edit: " << line << "\n";
+        return;
+    }
+
+    int cell = grid.index(x, y);
+    bool wasBlocked = grid.blocked(cell);
+    grid.cells[cell] = value;
+    if (grid.blocked(cell) != wasBlocked) {
+        if (options.cache) options.cache->clear();
+        if (arena.replanner) arena.replanner->cellChanged(cell);
+        if (options.hierarchy) options.hierarchy->cellChanged(cell);
+    }
+}
+
+/**
+ * @brief           answer queries, one per line, until the input is closed. Blank lines are skipped.
+ *                  Each answer is flushed as soon as it is written, so clients can pipeline requests.
+ *                  Lines of the form "set x y value" change a map cell instead and get no answer
+ * @param in        stream queries are read from
+ * @param out       stream results are written to
+ * @param grid      graph along which robot moves
+ * @param options   engine and angle change penalty used when a query does not give one
+ * @param arena     search arena reused between queries
+ */
+void serveQueries(FILE* in, FILE* out, Grid& grid, const SearchOptions& options, SearchArena& arena) {
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    ostringstream record;
+    while (getline(&buffer, &capacity, in) != -1) {
+        string line = buffer;
+        line.erase(line.find_last_not_of("\r\n") + 1);
+        if (line.find_first_not_of(" \t") == string::npos) continue;
+        if (line.compare(line.find_first_not_of(" \t"), 4, "set ") == 0) {
+            applyEdit(line, grid, options, arena);
+            continue;
+        }
+
+        record.str("");
+        answerQuery(line, grid, options, arena, record);
+        const string& answer = record.str();
+        fwrite(answer.data(), 1, answer.size(), out);
+        fflush(out);
+    }
+    free(buffer);
+}
+
+/**
+ * @brief               read every query from the input, answer them in parallel and write the
+ *                      records in query order. Every worker owns its own search arena, every query
+ *                      starts without a replanner and the grid is shared read-only, so the output is
+ *                      identical for any number of threads
+ * @param in            stream queries are read from, one per line as for serveQueries()
+ * @param out           stream results are written to
+ * @param grid          graph along which robot moves
+ * @param options       engine and angle change penalty used when a query does not give one
+ * @param threadCount   number of worker threads
+ */
+void answerBatch(FILE* in, FILE* out, const Grid& grid, const SearchOptions& options, int threadCount) {
+    vector<string> queries;
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    while (getline(&buffer, &capacity, in) != -1) {
+        string line = buffer;
+        line.erase(line.find_last_not_of("\r\n") + 1);
+        if (line.find_first_not_of(" \t") != string::npos) queries.push_back(line);
+    }
+    free(buffer);
+
+    vector<string> results(queries.size());
+    vector<SearchArena> arenas(threadCount);
+    auto started = chrono::steady_clock::now();
+    runWorkStealing(queries.size(), threadCount, [&](int worker, size_t query) {
+        ostringstream record;
+        // a replanner kept from the worker's previous query would make the counts depend on scheduling
+        arenas[worker].replanner.reset();
+        answerQuery(queries[query], grid, options, arenas[worker], record);
+        results[query] = record.str();
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    for (const string& result : results) fwrite(result.data(), 1, result.size(), out);
+    fflush(out);
+    cerr << queries.size() << " queries on " << threadCount << " threads in " << seconds << " s ("
+         << (seconds > 0 ? queries.size() / seconds : 0) << " queries/sec)\n";
+}
+
+/**
+ * @brief               accept connections on a local Unix socket and serve each one's queries in turn
+ * @param socketPath    file system path of the socket. Any existing file at the path is replaced
+ * @param grid          graph along which robot moves
+ * @param options       engine and angle change penalty used when a query does not give one
+ * @param arena         search arena reused between queries
+ * @return              false if the socket could not be set up. Otherwise serves until killed
+ */
+bool serveSocket(const string& socketPath, Grid& grid, const SearchOptions& options, SearchArena& arena) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path too long: " << socketPath << "\n";
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        cerr << "Could not listen on " << socketPath << "\n";
+        if (listener >= 0) close(listener);
+        return false;
+    }
+
+    // a client hanging up mid-answer must not take the server down with it
+    signal(SIGPIPE, SIG_IGN);
+    cerr << "Serving queries on " << socketPath << "\n";
+    while (true) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) continue;
+        FILE* in = fdopen(connection, "r");
+        FILE* out = fdopen(dup(connection), "w");
+        if (in && out) serveQueries(in, out, grid, options, arena);
+        if (in) fclose(in);
+        else close(connection);
+        if (out) fclose(out);
+    }
+}
+
+/**
+ * @brief Benchmark corpus entry: a random map of a given size and obstacle density
+ */
+struct BenchCase {
+    int rows;           // number of rows (height/y of graph)
+    int cols;           // number of columns (width/x of graph)
+    double density;     // chance of each cell being an obstacle
+};
+
+/**
+ * @brief               Benchmark corpus
+ * @param BENCH_CASES   maps searched by --bench, smallest first
+ * @param BENCH_QUERIES number of start/goal pairs searched on each map
+ */
+const BenchCase BENCH_CASES[] = {
+    {64, 64, 0.1}, {64, 64, 0.25}, {256, 256, 0.1}, {256, 256, 0.25}, {1024, 1024, 0.1}, {1024, 1024, 0.25},
+};
+const int BENCH_QUERIES = 20;
+
+const char* engineName(Engine engine) {
+    switch (engine) {
+        case Engine::JPS: return "jps";
+        case Engine::DSTAR: return "dstar";
+        case Engine::HPA: return "hpa";
+        case Engine::BIDIR: return "bidir";
+        case Engine::THETA: return "theta";
+        case Engine::ASTAR:
+        default: return "astar";
+    }
+}
+
+const char* heuristicName(Heuristic heuristic) {
+    switch (heuristic) {
+        case Heuristic::EUCLIDEAN: return "euclid";
+        case Heuristic::TABLE: return "table";
+        case Heuristic::OCTILE:
+        default: return "octile";
+    }
+}
+
+/**
+ * @brief           build a benchmark map and its queries. Obstacles are placed independently at random,
+ *                  and each start/goal pair is drawn from a single 8-connected region of free cells,
+ *                  so every query has a solution
+ * @param bench     size and obstacle density of the map
+ * @param rng       random source. The same seed always gives the same map and queries
+ * @param grid      set to the map
+ * @param queries   set to BENCH_QUERIES {start_x, start_y, goal_x, goal_y} queries
+ */
+void makeBenchMap(const BenchCase& bench, mt19937& rng, Grid& grid, vector<array<int, 4>>& queries) {
+    grid.resize(bench.rows, bench.cols);
+    bernoulli_distribution obstacle(bench.density);
+    for (int i = 0; i < bench.rows; ++i) {
+        for (int j = 0; j < bench.cols; ++j) grid.at(i, j) = obstacle(rng) ? Grid::OBSTACLE : 0;
+    }
+
+    // label regions by flood fill. The border is made of obstacles, so no bounds checks are needed
+    vector<int> region(grid.cellCount, -1);
+    vector<int> stack;
+    int regions = 0;
+    for (size_t first = 0; first < grid.cellCount; ++first) {
+        if (grid.blocked(first) || region[first] != -1) continue;
+        region[first] = regions;
+        stack.push_back(first);
+        while (!stack.empty()) {
+            int cell = stack.back();
+            stack.pop_back();
+            for (int offset : grid.moveOffset) {
+                if (!grid.blocked(cell + offset) && region[cell + offset] == -1) {
+                    region[cell + offset] = regions;
+                    stack.push_back(cell + offset);
+                }
+            }
+        }
+        ++regions;
+    }
+
+    uniform_int_distribution<int> xOf(0, bench.cols - 1), yOf(0, bench.rows - 1);
+    queries.clear();
+    while (int(queries.size()) < BENCH_QUERIES) {
+        int start_x = xOf(rng), start_y = yOf(rng);
+        int start = grid.index(start_x, start_y);
+        if (grid.blocked(start)) continue;
+        // a start in a small region may have no partner; give up on it after a while
+        for (int tries = 0; tries < 1000; ++tries) {
+            int goal_x = xOf(rng), goal_y = yOf(rng);
+            int goal = grid.index(goal_x, goal_y);
+            if (goal != start && region[goal] == region[start]) {
+                queries.push_back({start_x, start_y, goal_x, goal_y});
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @return  peak resident set size of the process so far, in kilobytes
+ */
+long peakMemoryKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief               search one benchmark case and write its results as a JSON object. The case's map and
+ *                      queries come from the seed, and the case is searched repeat times from a cold heuristic
+ *                      cache and planner; the minimum and median search time over the repeats are reported, along
+ *                      with the nodes generated and, for the engines that close nodes in the search arena (astar,
+ *                      jps, bidir, theta), the nodes expanded. Builds with -DSEARCH_STATS add the search counters
+ *                      of the last repeat. Map generation, HPA preprocessing (reported separately) and bookkeeping
+ *                      are not timed
+ * @param out           stream the JSON object is written to
+ * @param bench         size and obstacle density of the map
+ * @param baseOptions   engine, heuristic and angle change penalty
+ * @param threadCount   number of threads used to preprocess maps for hpa
+ * @param clusterSize   cluster width and height for hpa
+ * @param seed          seed of the corpus
+ * @param repeat        number of times the case is searched
+ */
+void runBenchCase(ostream& out, const BenchCase& bench, const SearchOptions& baseOptions, int threadCount, int clusterSize,
+                  unsigned seed, int repeat) {
+    // seeded from the case itself, so a case's map stays the same when cases are added or reordered
+    seed_seq caseSeed{seed, unsigned(bench.rows), unsigned(bench.cols), unsigned(bench.density * 1000)};
+    mt19937 rng(caseSeed);
+    Grid grid;
+    vector<array<int, 4>> queries;
+    makeBenchMap(bench, rng, grid, queries);
+
+    SearchOptions options = baseOptions;
+    HeuristicCache cache;
+    options.cache = &cache;
+    HierarchyCache hierarchy(grid, threadCount, clusterSize);
+    double buildMs = 0;
+    if (options.engine == Engine::HPA) {
+        auto started = chrono::steady_clock::now();
+        hierarchy.get(options.weight);
+        buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        options.hierarchy = &hierarchy;
+    }
+    bool countsExpanded = options.engine == Engine::ASTAR || options.engine == Engine::JPS
+                          || options.engine == Engine::BIDIR || options.engine == Engine::THETA;
+
+    SearchArena arena;
+    vector<double> times;
+    long long generated = 0, expanded = 0;
+    int solved = 0;
+    double pathCost = 0;
+    for (int r = 0; r < repeat; ++r) {
+        cache.clear();
+        arena.replanner.reset();
+        generated = expanded = solved = 0;
+        pathCost = 0;
+        searchStats = SearchStats();
+        double elapsed = 0;
+        for (const auto& query : queries) {
+            auto started = chrono::steady_clock::now();
+            auto result = runSearch(query[0], query[1], query[2], query[3], grid, options, arena);
+            elapsed += chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+            generated += get<1>(result);
+            if (get<0>(result) > 0) {
+                ++solved;
+                pathCost += get<3>(result).back();
+            }
+            if (countsExpanded) {
+                for (uint64_t word : arena.closed) expanded += __builtin_popcountll(word);
+                if (options.engine == Engine::BIDIR) {
+                    for (uint64_t word : arena.reverse->closed) expanded += __builtin_popcountll(word);
+                }
+            }
+        }
+        times.push_back(elapsed);
+    }
+    sort(times.begin(), times.end());
+
+    out << "\n  {\"name\": \"" << bench.rows << "x" << bench.cols << "-d" << bench.density
+        << "\", \"rows\": " << bench.rows << ", \"cols\": " << bench.cols << ", \"density\": " << bench.density
+        << ", \"solved\": " << solved << ", \"time_ms_min\": " << times.front()
+        << ", \"time_ms_median\": " << times[times.size() / 2] << ", \"build_ms\": " << buildMs
+        << ", \"nodes_generated\": " << generated << ", \"nodes_expanded\": ";
+    if (countsExpanded) out << expanded;
+    else out << "null";
+    out << ", \"path_cost\": " << pathCost << ", \"peak_rss_kb\": " << peakMemoryKb();
+    if (SEARCH_STATS_ENABLED) {
+        out << ", \"stats\": ";
+        writeSearchStats(out);
+    }
+    out << "}";
+}
+
+/**
+ * @brief       run part of the benchmark in a child process, so that peakMemoryKb() there measures that part
+ *              alone instead of the largest case run so far. Runs it in this process if no child can be started
+ * @param body  writes its results to the given stream
+ * @return      what body wrote
+ */
+string runIsolated(const function<void(ostream&)>& body) {
+    ostringstream text;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        body(text);
+        return text.str();
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        body(text);
+        return text.str();
+    }
+    if (child == 0) {
+        close(fds[0]);
+        body(text);
+        string result = text.str();
+        for (size_t sent = 0; sent < result.size();) {
+            ssize_t written = write(fds[1], result.data() + sent, result.size() - sent);
+            if (written <= 0) break;
+            sent += written;
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    string result;
+    char buffer[4096];
+    for (ssize_t got; (got = read(fds[0], buffer, sizeof(buffer))) > 0;) result.append(buffer, got);
+    close(fds[0]);
+    waitpid(child, nullptr, 0);
+    return result;
+}
+
+/**
+ * @brief               run the benchmark corpus and write the results as JSON. Every map and query comes from
+ *                      the seed, so runs with the same seed and options search exactly the same problems.
+ *                      Each case runs in its own child process, so its peak_rss_kb is the peak memory of that
+ *                      case alone. See runBenchCase() for what is measured
+ * @param out           stream the JSON document is written to
+ * @param baseOptions   engine, heuristic and angle change penalty
+ * @param threadCount   number of threads used to preprocess maps for hpa
+ * @param clusterSize   cluster width and height for hpa
+ * @param seed          seed of the corpus
+ * @param repeat        number of times each case is searched
+ */
+void runBenchmark(ostream& out, const SearchOptions& baseOptions, int threadCount, int clusterSize, unsigned seed, int repeat) {
+    out << "{\"program\": \"Project1\", \"engine\": \"" << engineName(baseOptions.engine)
+        << "\", \"heuristic\": \"" << heuristicName(baseOptions.heuristic) << "\", \"k\": " << baseOptions.weight
+        << ", \"seed\": " << seed << ", \"repeat\": " << repeat << ", \"queries\": " << BENCH_QUERIES << ", \"cases\": [";
+
+    int index = 0;
+    for (const BenchCase& bench : BENCH_CASES) {
+        out << (index++ ? "," : "") << runIsolated([&](ostream& caseOut) {
+            runBenchCase(caseOut, bench, baseOptions, threadCount, clusterSize, seed, repeat);
+        });
+        out.flush();
+    }
+    out << "\n]}\n";
+}
+
+/**
+ * @brief               Randomized check of the engines against search()
+ * @param CHECK_MAPS    number of random maps searched by --check
+ * @param CHECK_GOALS   goals queried on each map
+ * @param CHECK_STARTS  starts queried for each goal, with random map edits after each query
+ */
+const int CHECK_MAPS = 300;
+const int CHECK_GOALS = 3;
+const int CHECK_STARTS = 4;
+
+/**
+ * @brief           walk a solution from the start and add up its cost
+ * @param solution  list of moves to walk
+ * @param weight    angle change penalty
+ * @return          cost of the path, or -1 if it enters a blocked cell or does not end at the goal
+ */
+double replayCost(const Grid& grid, int start_x, int start_y, int goal_x, int goal_y, const vector<int>& solution, double weight) {
+    int x = start_x, y = start_y, heading = -1;
+    double cost = 0;
+    for (int move : solution) {
+        if (!grid.contains(x + MOVES[move][1], y + MOVES[move][2]) || grid.blocked(grid.index(x + MOVES[move][1], y + MOVES[move][2]))) {
+            return -1;
+        }
+        cost += calcMoveCost(x, y, x + MOVES[move][1], y + MOVES[move][2], heading, move, weight);
+        x += MOVES[move][1];
+        y += MOVES[move][2];
+        heading = move;
+    }
+    return x == goal_x && y == goal_y ? cost : -1;
+}
+
+/**
+ * @brief               search random maps with an engine and with search(), and report every query where the
+ *                      engine's path is invalid or costs more or less than search()'s. Each goal is queried from
+ *                      several starts with random cell edits in between, which dstar repairs incrementally
+ * @param out           stream the mismatches and a summary line are written to
+ * @param baseOptions   engine, heuristic and angle change penalty
+ * @param seed          seed of the maps, queries and edits
+ * @return              true if every query matched
+ */
+bool runCheck(ostream& out, const SearchOptions& baseOptions, unsigned seed) {
+    SearchOptions options = baseOptions, reference = baseOptions;
+    reference.engine = Engine::ASTAR;
+    HeuristicCache cache;
+    options.cache = reference.cache = &cache;
+
+    int queries = 0, mismatches = 0;
+    for (int map = 0; map < CHECK_MAPS; ++map) {
+        seed_seq mapSeed{seed, unsigned(map)};
+        mt19937 rng(mapSeed);
+        uniform_int_distribution<int> sizeOf(4, 32);
+        Grid grid;
+        grid.resize(sizeOf(rng), sizeOf(rng));
+        bernoulli_distribution obstacle(uniform_real_distribution<double>(0, 0.4)(rng));
+        for (int i = 0; i < grid.rows; ++i) {
+            for (int j = 0; j < grid.cols; ++j) grid.at(i, j) = obstacle(rng) ? Grid::OBSTACLE : 0;
+        }
+        uniform_int_distribution<int> xOf(0, grid.cols - 1), yOf(0, grid.rows - 1), editsOf(0, 3);
+        cache.clear();
+
+        SearchArena arena, referenceArena;
+        for (int goal = 0; goal < CHECK_GOALS; ++goal) {
+            int goal_x = xOf(rng), goal_y = yOf(rng);
+            for (int start = 0; start < CHECK_STARTS; ++start) {
+                int start_x = xOf(rng), start_y = yOf(rng);
+                auto result = runSearch(start_x, start_y, goal_x, goal_y, grid, options, arena);
+                auto expected = runSearch(start_x, start_y, goal_x, goal_y, grid, reference, referenceArena);
+                double cost = get<0>(result) > 0 ? replayCost(grid, start_x, start_y, goal_x, goal_y, get<2>(result), options.weight) : -1;
+                double expectedCost = get<0>(expected) > 0 ? replayCost(grid, start_x, start_y, goal_x, goal_y, get<2>(expected), options.weight) : -1;
+                ++queries;
+                if ((get<0>(result) > 0 && cost < 0) || fabs(cost - expectedCost) > 1e-6) {
+                    ++mismatches;
+                    out << "map " << map << " (" << grid.rows << "x" << grid.cols << "), query " << start_x << " " << start_y << " "
+                        << goal_x << " " << goal_y << ": " << engineName(options.engine) << " "
+                        << (get<0>(result) == 0 ? string("no path") : cost < 0 ? string("invalid path") : to_string(cost))
+                        << ", astar " << (expectedCost < 0 ? string("no path") : to_string(expectedCost)) << "\n";
+                }
+
+                for (int edits = editsOf(rng); edits > 0; --edits) {
+                    int cell = grid.index(xOf(rng), yOf(rng));
+                    bool wasBlocked = grid.blocked(cell);
+                    grid.cells[cell] = wasBlocked ? 0 : Grid::OBSTACLE;
+                    cache.clear();
+                    if (arena.replanner) arena.replanner->cellChanged(cell);
+                }
+            }
+        }
+    }
+    out << queries << " queries on " << CHECK_MAPS << " maps, " << mismatches << " mismatches\n";
+    return mismatches == 0;
+}
+
+/**
+ * @brief   model A* search along a graph
+ * @param   argv    optional arguments: -i <input file> -o <output file> -k <angle change penalty>
+ *                  --rle run-length encodes the moves and f(n) lines of the output, see writeRuns
+ *                  --map <file> also writes the map with the solution marked, in the input format, which
+ *                  vis.py draws
+ *                  --convert <binary map file> converts the input map to the binary format and exits
+ *                  --serve answers "start_x start_y goal_x goal_y [k]" queries read from stdin
+ *                  --socket <path> answers the same queries over a local Unix socket
+ *                  --batch answers every query on stdin in parallel, see --threads, and writes them in order
+ *                  --threads <n> number of worker threads for --batch, default all cores
+ *                  --engine <astar|jps|dstar|hpa|bidir|theta> search engine, default astar. dstar keeps its search
+ *                  between queries to the same goal and repairs it after "set x y value" map edits in server modes.
+ *                  hpa preprocesses the map once on --threads threads and rebuilds only edited clusters.
+ *                  bidir searches from both ends at once; theta finds any-angle paths and always uses euclid
+ *                  --cluster <n> cluster width and height for hpa, default 16. Smaller clusters preprocess
+ *                  faster, larger ones give a smaller abstract graph to search
+ *                  --heuristic <euclid|octile|table> heuristic, default octile. Goal distance tables
+ *                  are cached per goal for the lifetime of the process
+ *                  --bench searches a generated corpus of maps with the chosen engine and heuristic and writes
+ *                  timings, node counts and peak memory as JSON to stdout. No input map is read
+ *                  --seed <s> seed of the benchmark corpus, default 1
+ *                  --repeat <n> number of times each benchmark case is searched, default 3
+ *                  --check compares the chosen engine (astar, jps, dstar or bidir) with astar on random maps
+ *                  and map edits generated from --seed, prints any query where they disagree and exits
+ *                  with 1 if there was one
+ *                  --trace <file> writes the order in which astar, jps, bidir or theta expand nodes to a binary file that
+ *                  vis.py can replay. Needs a build with -DSEARCH_STATS, which also prints the search
+ *                  counters to cerr
+ * @return  0 on success. Prints output to specified text file
+ */
+int main(int argc, char* argv[]) {
+
+    string inputName = INPUTFILE;
+    string outputName = OUTPUTFILE;
+    SearchOptions options;
+    HeuristicCache cache;
+    options.cache = &cache;
+    string convertName;
+    string socketPath;
+    string traceName;
+    string mapName;
+    bool runLength = false;
+    bool serve = false;
+    bool batch = false;
+    bool bench = false;
+    bool check = false;
+    unsigned seed = 1;
+    int repeat = 3;
+    int threadCount = max(1u, thread::hardware_concurrency());
+    int clusterSize = HierarchicalPlanner::DEFAULT_CLUSTER_SIZE;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 < argc && arg == "-i") inputName = argv[++i];
+        else if (i + 1 < argc && arg == "-o") outputName = argv[++i];
+        else if (i + 1 < argc && arg == "-k") options.weight = atof(argv[++i]);
+        else if (i + 1 < argc && arg == "--convert") convertName = argv[++i];
+        else if (i + 1 < argc && arg == "--socket") socketPath = argv[++i];
+        else if (i + 1 < argc && arg == "--trace") traceName = argv[++i];
+        else if (i + 1 < argc && arg == "--map") mapName = argv[++i];
+        else if (arg == "--rle") runLength = true;
+        else if (i + 1 < argc && arg == "--threads") threadCount = max(1, atoi(argv[++i]));
+        else if (i + 1 < argc && arg == "--cluster") clusterSize = max(2, atoi(argv[++i]));
+        else if (i + 1 < argc && arg == "--engine" && parseEngine(argv[i + 1], options.engine)) ++i;
+        else if (i + 1 < argc && arg == "--heuristic" && parseHeuristic(argv[i + 1], options.heuristic)) ++i;
+        else if (arg == "--serve") serve = true;
+        else if (i + 1 < argc && arg == "--seed") seed = strtoul(argv[++i], nullptr, 10);
+        else if (i + 1 < argc && arg == "--repeat") repeat = max(1, atoi(argv[++i]));
+        else if (arg == "--batch") batch = true;
+        else if (arg == "--bench") bench = true;
+        else if (arg == "--check") check = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [-i input] [-o output [--rle] [--map file]] [-k penalty] [--convert binary_map]"
+                 << " [--serve | --socket path | --batch [--threads n]] [--engine astar|jps|dstar|hpa|bidir|theta [--cluster n]]"
+                 << " [--heuristic euclid|octile|table] [--bench [--seed s] [--repeat n] | --check [--seed s]] [--trace file]\n";
+            return 1;
+        }
+    }
+    if (!traceName.empty() && !SEARCH_STATS_ENABLED) {
+        cerr << "--trace needs a build with -DSEARCH_STATS\n";
+        return 1;
+    }
+
+    if (bench) {
+        runBenchmark(cout, options, threadCount, clusterSize, seed, repeat);
+        return 0;
+    }
+    if (check) {
+        // hpa and theta do not promise search()'s costs, so there is nothing to hold them to
+        if (options.engine == Engine::HPA || options.engine == Engine::THETA) {
+            cerr << "--check needs --engine astar, jps, dstar or bidir\n";
+            return 1;
+        }
+        return runCheck(cout, options, seed) ? 0 : 1;
+    }
+
+    Grid grid;
+    int start_x, start_y, goal_x, goal_y;
+    if (!loadMap(inputName, grid, start_x, start_y, goal_x, goal_y)) return 1;
+
+    if (!convertName.empty()) {
+        if (!writeBinaryGrid(convertName, grid, start_x, start_y, goal_x, goal_y)) {
+            cerr << "Could not write " << convertName << "\n";
+            return 1;
+        }
+        cout << "Converted " << inputName << " to " << convertName;
+        return 0;
+    }
+
+    HierarchyCache hierarchy(grid, threadCount, clusterSize);
+    if (options.engine == Engine::HPA) {
+        hierarchy.get(options.weight);
+        options.hierarchy = &hierarchy;
+    }
+
+    if (batch) {
+        answerBatch(stdin, stdout, grid, options, threadCount);
+        return 0;
+    }
+
+    // Long-running modes: the map stays loaded and the search arena is reused for every query
+    if (!socketPath.empty() || serve) {
+        SearchArena arena;
+        if (!socketPath.empty()) return serveSocket(socketPath, grid, options, arena) ? 0 : 1;
+        serveQueries(stdin, stdout, grid, options, arena);
+        return 0;
+    }
+
+    int depth, nodes_generated;
+    vector<int> solution;
+    vector<double>costs;
+    // Initialize A* search
+    SearchArena arena;
+    vector<int32_t> trace;
+    if (!traceName.empty()) expansionTrace = &trace;
+    tie(depth, nodes_generated, solution, costs) = runSearch(start_x, start_y, goal_x, goal_y, grid, options, arena);
+    expansionTrace = nullptr;
+
+    if (SEARCH_STATS_ENABLED) {
+        cerr << "Search stats: ";
+        writeSearchStats(cerr);
+        cerr << "\n";
+    }
+    if (!traceName.empty() && !writeTrace(traceName, grid, start_x, start_y, goal_x, goal_y, trace)) {
+        cerr << "Could not write " << traceName << "\n";
+    }
+
+    // Print solution to output file, and the annotated map only when asked for
+    if (!solution.empty()) {
+        ofstream outputFile(outputName);
+        writeResult(outputFile, depth, nodes_generated, solution, costs, runLength);
+
+        if (!mapName.empty() && !writeAnnotatedMap(mapName, grid, start_x, start_y, goal_x, goal_y, solution)) {
+            cerr << "Could not write " << mapName << "\n";
+        }
+
+        cout << "Successfully output to " << outputName;
+    } else {
+        cout << "No solution available.\n";
+    }
+
+   return 0;
+}
+
+
@@ -1,328 +1,1687 @@
-/*
-  Project1.cpp
-  Evan Lee and Seha Kim
-  Solve a Kropki Sudoku puzzle
-  December/12/2024
-*/
-
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <algorithm>
-#include <cstring>
-#include <string>
-
-using namespace std;
-
-/**
- * @brief           Constant variables
- * @param SIZE      Size of Sudoku puzzle (number of rows / columns)
- * @param INPUTFILE The name of the file to be read from
- * @param OUTPUFILE The name of the file to be written to
- */
-const int SIZE = 9;
-const string INPUTFILE = "Input2.txt";
-const string OUTPUTFILE = "Output2.txt";
-
-/**
- * @brief Cell class. Used to represent Sudoku cells
- */
-struct Cell {
-    // Cells have a default value of 0 and a possible domain of all numbers from 1 through 9
-    int value = 0;
-    vector<int> d{1,2,3,4,5,6,7,8,9};
-};
-
-/**
- * @param board         A representation of the Sudoku puzzle. Represented as a 2-dimensional array of cells.
- * @param hConstraints  A representation of the horizontal constraints of the Sudoku puzzle. Represented as a 2-dimensional array of integers.
- * @param vConstraints  A representation of the vertical constraints of the Sudoku puzzle. Represented as a 2-dimensional array of integers.
- */
-Cell board[SIZE][SIZE];
-int hConstraints[SIZE][SIZE-1];
-int vConstraints[SIZE-1][SIZE];
-
-/**
- * @brief               Check if a given value for a cell will violate a rule. If there is no violation, assigns that value to the cell
- * @param row           The row of the cell
- * @param col           The column of the cell
- * @param val           The value to be given.
- * @return              Returns true if the given value does not violate any rules.
- *                      Returns false if the given value violates a rules.
- */
-bool validate(int row, int col, int val){
-    // Check for a digit overlap within the cell's 3x3 neighborhood
-    int startRow = row - (row % 3), startCol = col - (col % 3);
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            if (board[startRow + i][startCol + j].value == val) {return false;}
-        }
-    }
-
-    // Check for a digit overlap within the cell's rows and columns
-    for (int i = 0; i < 9; ++i) {
-        if (board[row][i].value == val || board[i][col].value == val) {return false;}
-    }
-    
-    // Check for heuristic violations between the cell and its neighbor above it
-    if (row > 0) {
-        int above = board[row - 1][col].value;
-        if (above != 0){
-            if (vConstraints[row - 1][col] == 1 && abs(above - val) != 1) {return false;}
-            if (vConstraints[row - 1][col] == 2 && (above != 2 * val && val != 2 * above)) {return false;}
-        }
-
-    }
-
-    // Check for heuristic violations between the cell and its neighbor below it
-    if (row < SIZE - 1) {
-        int below = board[row + 1][col].value;
-        if (below != 0){
-            if (vConstraints[row][col] == 1 && abs(below - val) != 1) {return false;}
-            if (vConstraints[row][col] == 2 && (below != 2 * val && val != 2 * below)) {return false;}
-        }
-    }
-
-    // Check for heuristic violations between the cell and its neighbor to the left
-    if (col > 0) {
-        int left = board[row][col - 1].value;
-        if (left != 0){
-            if (hConstraints[row][col - 1] == 1 && abs(left - val) != 1) {return false;}
-            if (hConstraints[row][col - 1]== 2 && (left != 2 * val && val != 2 * left)) {return false;}
-        }
-    }
-
-    // Check for heuristic violations between the cell and its neighbor to the right.
-    if (col < SIZE - 1) {
-        int right = board[row][col + 1].value;
-        if (right != 0){
-            if (hConstraints[row][col] == 1 && abs(right - val) != 1) {return false;}
-            if (hConstraints[row][col] == 2 && (right != 2 * val && val != 2 * right)) {return false;}
-        }
-    }
-    
-    return true;
-}
-
-/**
- * @brief       Uses minimum remaining value and degree heuristics to find the next unassigned variable to assign a value
- * @return      A pair of integers, denoting the row and column of the next cell to assign a value
- */
-pair<int, int> find_next() {
-    int min_remaining = 10;
-    int max_degree = -1;
-    pair<int, int> selected = {-1, -1};
-
-    for (int row = 0; row < SIZE; row++) {
-        for (int col = 0; col < SIZE; col++) {
-            if (board[row][col].value == 0) { 
-                int remaining = board[row][col].d.size();
-                
-                // Check for the degree of the cell
-                int degree = 0;
-
-                // Increment degree for each cell filled in the cell's 3x3 neighborhood
-                int box_row = row - row % 3, box_col = col - col % 3;
-                for (int i = 0; i < 3; i++) {
-                    for (int j = 0; j < 3; j++) {
-                        if (box_row + i != row && box_col + j != col && board[box_row + i][box_col + j].value == 0) {degree++;}
-                    }
-                }
-
-                // Increment degree for each cell filled in the cell's row and column
-                for (int i = 0; i < SIZE; i++) {
-                    if (i != col && board[row][i].value == 0) {degree++;}
-                    if (i != row && board[i][col].value == 0) {degree++;}
-                }
-
-                    // Check for heuristic violations between the cell and its neighbor above it
-                if (row > 0) {
-                    if (vConstraints[row - 1][col] == 1) {degree++;}
-                    if (vConstraints[row - 1][col] == 2) {degree++;}
-                }
-
-                // Check for heuristic violations between the cell and its neighbor below it
-                if (row < SIZE - 1) {
-                    if (vConstraints[row][col] == 1) {degree++;}
-                    if (vConstraints[row][col] == 2) {degree++;}
-
-                }
-
-                // Check for heuristic violations between the cell and its neighbor to the left
-                if (col > 0) {
-                    if (hConstraints[row][col - 1] == 1) {degree++;}
-                    if (hConstraints[row][col - 1]== 2) {degree++;}
-                }
-
-                // Check for heuristic violations between the cell and its neighbor to the right.
-                if (col < SIZE - 1) {
-                        if (hConstraints[row][col] == 1) {degree++;}
-                        if (hConstraints[row][col] == 2) {degree++;}
-                }
-
-                // This cell takes precedence if it has the smallest domain of remaining cells or is tied
-                // for least remaining possible values and has the highest degree
-                if (remaining < min_remaining || (remaining == min_remaining && degree > max_degree)) {
-                    selected = {row, col};
-                    min_remaining = remaining;
-                    max_degree = degree;
-                }
-            }
-        }
-    }
-
-    return selected;
-}
-
-/**
- * @brief       Forward checking - checks if implementing a value will empty
- *              the domain of an unassigned neighbor.
- * @param row   The row of the cell to be checked
- * @param col   The column of the cell to be checked
- * @param val   The value to be implemented
- * @return      True if implementing the value does NOT result in an unassigned
- *              neighbor with an empty domain.
- *              False if implementing the value DOES result in an unassigned
- *              neighbor with an empty domain.
-*/ 
-bool forward_check(int row, int col, int val) {
-
-    // Forward check columns and rows
-    for (int i = 0; i < SIZE; i++) {
-        if (i != col && board[row][i].value == 0) {
-            vector<int>& domain = board[row][i].d;
-            domain.erase(remove(domain.begin(), domain.end(), val), domain.end());
-            if (domain.empty()) {return false;}
-        }
-        if (i != row && board[i][col].value == 0) {
-            vector<int>& domain = board[i][col].d;
-            domain.erase(remove(domain.begin(), domain.end(), val), domain.end());
-            if (domain.empty()) {return false;}
-        }
-    }
-
-    // Forward check within 3x3 neighborhood
-    int box_row = row - row % 3, box_col = col - col % 3;
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            if (box_row + i != row && box_col + j != col && board[box_row + i][box_col + j].value == 0) {
-                vector<int>& domain = board[box_row + i][box_col + j].d;
-                domain.erase(remove(domain.begin(), domain.end(), val), domain.end());
-                if (domain.empty()) {return false;}
-            }
-        }
-    }
-    return true;
-}
-
-/**
- * @brief   backtracking search for the puzzle
- * @return  true if every empty cell has been filled out (success)
- *          false if a cell cannot be filled out (failure)
- */
-bool backtracking_search() {
-    // find next unassigned cell
-    pair<int, int> coord = find_next(); 
-    // return success if no unassigned cells left
-    if (coord.first == -1 && coord.second == -1) return true;
-
-    // otherwise, begin testing values within that cell's domain
-    for (int val : board[coord.first][coord.second].d) {
-        // Validate domain values
-        if (validate(coord.first, coord.second, val)) { 
-            // Create a list of affected neighbors
-            vector<pair<int, int>> neighbors;
-            // Forward check for if validated value causes domain violations
-            if (forward_check(coord.first, coord.second, val)){                
-
-                // Assigns the value to the cell if no heuristics are violated
-                board[coord.first][coord.second].value = val; 
-
-                // Add affected neighbors in 3x3 neighborhood to list
-                int box_row = coord.first - coord.first % 3;
-                int box_col = coord.second - coord.second % 3;
-                for (int i = 0; i < 3; i++) {
-                    for (int j = 0; j < 3; j++) {
-                        if (box_row + i != coord.first && box_col + j != coord.second && board[box_row + i][box_col + j].value == 0) {
-                            neighbors.emplace_back(box_row + i, box_col + j);
-                        }
-                    }
-                }
-
-                // Add affected neighbors in column / row to list
-                for (int i = 0; i < SIZE; i++) {
-                    if (i != coord.first && board[i][coord.second].value == 0) {neighbors.emplace_back(i, coord.second);}
-                    if (i != coord.second && board[coord.first][i].value == 0) {neighbors.emplace_back(coord.first, i);}
-                }
-            
-                if (backtracking_search()) {return true;}
-            }
-
-            // If forward check or recursive search fails, undo assignment 
-            // and reset the domains of the cell's neighbors
-            board[coord.first][coord.second].value = 0;
-            for (const pair<int, int>& cell : neighbors) {
-                board[cell.first][cell.second].d.push_back(val);
-            }
-        }
-    }
-
-    return false;
-}
-
-/**
- * @brief       sudoku solver
- * @return      Prints output to specified text file
- */
-int main() {
-    string inputFile = INPUTFILE; // Replace with actual input file
-    string outputFile = OUTPUTFILE;
-
-    ifstream input(inputFile);
-
-    // copy game board to board
-    for (int i = 0; i < SIZE; i++){
-        for (int j = 0; j < SIZE; j++){
-            input >> board[i][j].value;
-            if (board[i][j].value != 0){
-                board[i][j].d.clear();
-                board[i][j].d.push_back(board[i][j].value);
-            }
-        }
-    }
-    input.ignore();
-    
-    // copy horizontal constraints graph
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE-1; j++) {
-            input >> hConstraints[i][j];
-        }
-    }
-    input.ignore();
-
-    // copy vertical constraints graph
-    for (int i = 0; i < SIZE-1; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            input >> vConstraints[i][j];
-        }
-    }
-    input.close();
-
-
-    // Initialize backtracking search. Output if a solution is found.
-    if (backtracking_search()){
-        cout << "Solved. Output to " << outputFile << endl;
-
-        ofstream output(outputFile);
-        for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            output << board[i][j].value << " ";
-        }
-        output << "\n";
-    }
-    output.close();
-    }
-
-    cout << "Program Finished";
-
-}
+/*
+  Project1.cpp
+  Evan Lee and Seha Kim
+  Solve a Kropki Sudoku puzzle
+  December/12/2024
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <tuple>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <numeric>
+#include <array>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @brief           Constant variables
+ * @param INPUTFILE The name of the file to be read from
+ * @param OUTPUFILE The name of the file to be written to
+ * @param BATCH_RECORDS Number of puzzles read, solved and written at a time in batch mode
+ * @param SPLIT_TASKS   Number of subproblems per thread the search tree is split into in parallel mode
+ */
+const string INPUTFILE = "Input2.txt";
+const string OUTPUTFILE = "Output2.txt";
+const size_t BATCH_RECORDS = 1024;
+const size_t SPLIT_TASKS = 16;
+
+/**
+ * @brief Counters of the backtracking search. Compiled in only when built with -DSOLVER_STATS; otherwise the
+ *        STAT_* macros expand to nothing and the search carries no extra work
+ * @param assignments   Values assigned by the search. Givens are not counted
+ * @param backtracks    Values assigned or propagated by the search and then undone
+ * @param removals      Digits removed from domains by propagation
+ * @param depth         Number of search assignments on the current path
+ * @param maxDepth      Deepest path reached
+ */
+struct SolverStats {
+    long long assignments = 0;
+    long long backtracks = 0;
+    long long removals = 0;
+    int depth = 0;
+    int maxDepth = 0;
+};
+
+#ifdef SOLVER_STATS
+constexpr bool SOLVER_STATS_ENABLED = true;
+#define STAT_ADD(field, n) (stats.field += (n))
+#define STAT_MAX(field, value) (stats.field = max(stats.field, (value)))
+#else
+constexpr bool SOLVER_STATS_ENABLED = false;
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_MAX(field, value) ((void)0)
+#endif
+
+/**
+ * @brief Cell lookup tables for a puzzle with B x B boxes, built at compile time
+ * @param SIZE      Size of Sudoku puzzle (number of rows / columns)
+ * @param CELLS     Number of cells in the puzzle
+ * @param PEERS     Number of cells sharing a row, column or box with a cell
+ * @param UNITS     Number of rows, columns and boxes
+ * @param Mask      Domain mask type, wide enough to hold a bit per digit. Digit v is bit v - 1
+ * @param peers     For each cell, the cells sharing its row, column or box
+ * @param adjacent  For each cell, the cell above, below, to the left and to the right of it, or -1 at an edge
+ * @param dotMask   For each dot type (1 = white, 2 = black) and digit, the mask of digits allowed next to it
+ * @param units     The cells of each row, column and box
+ */
+template <int B>
+struct CellTables {
+    static constexpr int SIZE = B * B;
+    static constexpr int CELLS = SIZE * SIZE;
+    static constexpr int PEERS = 2 * (SIZE - 1) + (B - 1) * (B - 1);
+    static constexpr int UNITS = 3 * SIZE;
+    using Mask = conditional_t<SIZE <= 16, uint16_t, uint32_t>;
+
+    int peers[CELLS][PEERS];
+    int adjacent[CELLS][4];
+    Mask dotMask[3][SIZE + 1];
+    int units[UNITS][SIZE];
+};
+
+template <int B>
+constexpr CellTables<B> buildCellTables() {
+    constexpr int SIZE = CellTables<B>::SIZE;
+    using Mask = typename CellTables<B>::Mask;
+    CellTables<B> t{};
+    for (int cell = 0; cell < CellTables<B>::CELLS; cell++) {
+        int row = cell / SIZE, col = cell % SIZE, count = 0;
+        int boxRow = row - row % B, boxCol = col - col % B;
+        for (int i = 0; i < SIZE; i++) {
+            if (i != col) t.peers[cell][count++] = row * SIZE + i;
+            if (i != row) t.peers[cell][count++] = i * SIZE + col;
+        }
+        for (int i = boxRow; i < boxRow + B; i++) {
+            for (int j = boxCol; j < boxCol + B; j++) {
+                if (i != row && j != col) t.peers[cell][count++] = i * SIZE + j;
+            }
+        }
+        t.adjacent[cell][0] = row > 0 ? cell - SIZE : -1;
+        t.adjacent[cell][1] = row < SIZE - 1 ? cell + SIZE : -1;
+        t.adjacent[cell][2] = col > 0 ? cell - 1 : -1;
+        t.adjacent[cell][3] = col < SIZE - 1 ? cell + 1 : -1;
+    }
+    for (int v = 1; v <= SIZE; v++) {
+        if (v > 1) t.dotMask[1][v] |= Mask(1) << (v - 2);
+        if (v < SIZE) t.dotMask[1][v] |= Mask(1) << v;
+        if (2 * v <= SIZE) t.dotMask[2][v] |= Mask(1) << (2 * v - 1);
+        if (v % 2 == 0) t.dotMask[2][v] |= Mask(1) << (v / 2 - 1);
+    }
+    for (int i = 0; i < SIZE; i++) {
+        for (int j = 0; j < SIZE; j++) {
+            t.units[i][j] = i * SIZE + j;
+            t.units[SIZE + i][j] = j * SIZE + i;
+            t.units[2 * SIZE + i][j] = (i / B * B + j / B) * SIZE + i % B * B + j % B;
+        }
+    }
+    return t;
+}
+
+template <int B>
+constexpr CellTables<B> CELL_TABLES = buildCellTables<B>();
+
+/**
+ * @brief Kropki Sudoku solver for a puzzle with B x B boxes. Holds the whole board state, so several
+ *        solvers can work on different puzzles in one process. Large at 25 x 25, so allocate on the heap.
+ */
+template <int B>
+struct KropkiSolver {
+    /**
+     * @brief           Constant variables
+     * @param BOX       Size of a Sudoku box (number of rows / columns in a box)
+     * @param DEGREES   Number of possible cell degrees (unassigned peers plus dots)
+     * @param WORDS     Number of 64-bit words in a set of cells
+     * @param ALL       Domain mask holding every digit
+     */
+    using Tables = CellTables<B>;
+    using Mask = typename Tables::Mask;
+    static constexpr int BOX = B;
+    static constexpr int SIZE = Tables::SIZE;
+    static constexpr int CELLS = Tables::CELLS;
+    static constexpr int PEERS = Tables::PEERS;
+    static constexpr int UNITS = Tables::UNITS;
+    static constexpr int DEGREES = PEERS + 4 + 1;
+    static constexpr int DEGREE_WORDS = (DEGREES + 63) / 64;
+    static constexpr int WORDS = (CELLS + 63) / 64;
+    static constexpr Mask ALL = Mask((1ULL << SIZE) - 1);
+    static constexpr const Tables& TABLES = CELL_TABLES<B>;
+
+    /**
+     * @brief Cell class. Used to represent Sudoku cells
+     */
+    struct Cell {
+        // Cells have a default value of 0 and a possible domain of every digit, stored as a bitmask
+        int value = 0;
+        Mask d = ALL;
+    };
+
+    /**
+     * @brief Trail entry. Records a cell's domain before it was changed
+     */
+    struct TrailEntry {
+        int cell;
+        Mask d;
+    };
+
+    /**
+     * @param board         A representation of the Sudoku puzzle. Represented as an array of cells, row by row.
+     * @param dots          The constraint between each cell and each of its TABLES.adjacent neighbors (0 = none, 1 = white, 2 = black)
+     * @param rowUsed       Mask of the digits assigned in each row
+     * @param colUsed       Mask of the digits assigned in each column
+     * @param boxUsed       Mask of the digits assigned in each box
+     * @param trail         Undo log of domain changes along the current search path. Every change removes at
+     *                      least one digit from a domain, so the path can never hold more than CELLS * SIZE entries
+     * @param trailSize     Number of entries in the trail
+     * @param queue         Cells whose domains changed and whose consequences have not been propagated yet
+     * @param queued        Whether each cell is currently in the queue
+     * @param queueSize     Number of cells in the queue
+     * @param nodes         Number of search nodes expanded
+     * @param solutions     Number of solutions found by the search
+     * @param solutionLimit The search stops once it has found this many solutions. Only the first solution
+     *                      is left on the board, and only when the limit is 1
+     * @param degree        Number of unassigned peers plus number of dots of each unassigned cell
+     * @param ordered       Whether each cell is currently in the buckets
+     * @param buckets       Unassigned cells keyed by domain size and degree, as bitsets over cell indices
+     * @param usedDegrees   For each domain size, the mask of degrees with a non-empty bucket
+     * @param cancel        When set, the search gives up as soon as the flag is raised
+     * @param nodeLimit     When not 0, the search gives up after expanding this many nodes
+     * @param stats         Search counters, see SolverStats
+     */
+    Cell board[CELLS];
+    int dots[CELLS][4];
+    Mask rowUsed[SIZE], colUsed[SIZE], boxUsed[SIZE];
+    TrailEntry trail[CELLS * SIZE];
+    int trailSize;
+    int queue[CELLS];
+    bool queued[CELLS];
+    int queueSize;
+    long long nodes;
+    long long solutions;
+    long long solutionLimit = 1;
+    int degree[CELLS];
+    bool ordered[CELLS];
+    uint64_t buckets[SIZE + 1][DEGREES][WORDS];
+    uint64_t usedDegrees[SIZE + 1][DEGREE_WORDS];
+    const atomic<bool>* cancel = nullptr;
+    long long nodeLimit = 0;
+    SolverStats stats;
+
+    KropkiSolver() {reset();}
+
+    /**
+     * @brief       Clear the board, constraints and search state so a new puzzle can be read
+     */
+    void reset() {
+        fill(board, board + CELLS, Cell());
+        memset(dots, 0, sizeof(dots));
+        memset(rowUsed, 0, sizeof(rowUsed));
+        memset(colUsed, 0, sizeof(colUsed));
+        memset(boxUsed, 0, sizeof(boxUsed));
+        memset(queued, 0, sizeof(queued));
+        memset(ordered, 0, sizeof(ordered));
+        memset(buckets, 0, sizeof(buckets));
+        memset(usedDegrees, 0, sizeof(usedDegrees));
+        trailSize = 0;
+        queueSize = 0;
+        nodes = 0;
+        solutions = 0;
+        stats = SolverStats();
+    }
+
+    /**
+     * @brief       Place a given digit. Call before prepare() or solve()
+     * @param cell  The cell
+     * @param value The digit
+     */
+    void give(int cell, int value) {
+        assign(cell, value);
+        board[cell].d = Mask(1) << (value - 1);
+    }
+
+    /**
+     * @brief       Set the constraint between a cell and one of its neighbors, on both cells
+     * @param cell  The cell
+     * @param n     The neighbor: 0 = above, 1 = below, 2 = left, 3 = right
+     * @param dot   0 = none, 1 = white, 2 = black
+     */
+    void set_dot(int cell, int n, int dot) {
+        dots[cell][n] = dot;
+        dots[TABLES.adjacent[cell][n]][n ^ 1] = dot;
+    }
+
+    /**
+     * @brief       Read a puzzle: the givens, then the horizontal and vertical constraints
+     * @param input The stream to read from
+     * @return      False if the stream ran out before the puzzle was complete
+     */
+    bool read(istream& input) {
+        reset();
+
+        // copy game board to board
+        for (int i = 0; i < CELLS; i++){
+            int value;
+            input >> value;
+            if (value != 0){give(i, value);}
+        }
+
+        // copy horizontal constraints graph, recording it on the cells to either side
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE-1; j++) {
+                int dot;
+                input >> dot;
+                set_dot(i * SIZE + j, 3, dot);
+            }
+        }
+
+        // copy vertical constraints graph, recording it on the cells above and below
+        for (int i = 0; i < SIZE-1; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                int dot;
+                input >> dot;
+                set_dot(i * SIZE + j, 1, dot);
+            }
+        }
+
+        return !input.fail();
+    }
+
+    /**
+     * @brief       Write the board, one row per line
+     * @param output The stream to write to
+     */
+    void write(ostream& output) const {
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                output << board[i * SIZE + j].value << " ";
+            }
+            output << "\n";
+        }
+    }
+
+    /**
+     * @brief       Propagate the givens and dots, then run the backtracking search
+     * @return      True if a solution was found, in which case it is left on the board
+     */
+    bool solve() {
+        return prepare() && backtracking_search();
+    }
+
+    /**
+     * @brief       Fill the MRV buckets and propagate the givens and dots, ready for search
+     * @return      False if the puzzle is already inconsistent
+     */
+    bool prepare() {
+        for (int cell = 0; cell < CELLS; cell++) {
+            queued[cell] = true;
+            queue[queueSize++] = cell;
+        }
+        order_init();
+        return propagate();
+    }
+
+    /**
+     * @brief       Count the puzzle's solutions with the same propagation and search as solve()
+     * @param limit Stop once this many solutions have been found. 2 is enough to tell whether a solution is unique
+     * @return      The number of solutions found, at most limit
+     */
+    long long count_solutions(long long limit) {
+        solutionLimit = limit;
+        if (prepare()) {backtracking_search();}
+        solutionLimit = 1;
+        return solutions;
+    }
+
+    /**
+     * @brief       Make a sequence of search decisions, propagating each one as the search would
+     * @param path  The (cell, value) decisions, in order
+     * @return      False if some decision is invalid or leads to an empty domain
+     */
+    bool apply(const vector<pair<int, int>>& path) {
+        for (const auto& [cell, val] : path) {
+            if (!validate(cell, val) || !narrow(cell, Mask(1) << (val - 1)) || !propagate()) {return false;}
+            assign(cell, val);
+        }
+        return true;
+    }
+
+    /**
+     * @brief       Index of the box holding a cell
+     */
+    static int box_of(int cell) {
+        return (cell / SIZE) / BOX * BOX + (cell % SIZE) / BOX;
+    }
+
+    /**
+     * @brief       Add an unassigned cell to the bucket for its current domain size and degree
+     */
+    void order_insert(int cell) {
+        int size = __builtin_popcount(board[cell].d);
+        buckets[size][degree[cell]][cell / 64] |= 1ULL << (cell % 64);
+        usedDegrees[size][degree[cell] / 64] |= 1ULL << (degree[cell] % 64);
+        ordered[cell] = true;
+    }
+
+    /**
+     * @brief       Remove a cell from the bucket for its current domain size and degree
+     */
+    void order_remove(int cell) {
+        int size = __builtin_popcount(board[cell].d);
+        uint64_t* bucket = buckets[size][degree[cell]];
+        bucket[cell / 64] &= ~(1ULL << (cell % 64));
+        ordered[cell] = false;
+        for (int w = 0; w < WORDS; w++) {
+            if (bucket[w]) {return;}
+        }
+        usedDegrees[size][degree[cell] / 64] &= ~(1ULL << (degree[cell] % 64));
+    }
+
+    /**
+     * @brief       Compute every unassigned cell's degree and fill the buckets. Called once the puzzle is read
+     */
+    void order_init() {
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (board[cell].value != 0) {continue;}
+            degree[cell] = 0;
+            for (int peer : TABLES.peers[cell]) {
+                if (board[peer].value == 0) {degree[cell]++;}
+            }
+            for (int n = 0; n < 4; n++) {
+                if (dots[cell][n] != 0) {degree[cell]++;}
+            }
+            order_insert(cell);
+        }
+    }
+
+    /**
+     * @brief       Assign a value to a cell and mark it used in the cell's row, column and box
+     * @param cell  The cell to assign
+     * @param val   The value to assign
+     */
+    void assign(int cell, int val) {
+        Mask bit = Mask(1) << (val - 1);
+        if (ordered[cell]) {order_remove(cell);}
+        board[cell].value = val;
+        rowUsed[cell / SIZE] |= bit;
+        colUsed[cell % SIZE] |= bit;
+        boxUsed[box_of(cell)] |= bit;
+        for (int peer : TABLES.peers[cell]) {
+            if (ordered[peer]) {
+                order_remove(peer);
+                degree[peer]--;
+                order_insert(peer);
+            }
+        }
+    }
+
+    /**
+     * @brief       Clear a cell's value and release it in the cell's row, column and box
+     * @param cell  The cell to clear
+     */
+    void unassign(int cell) {
+        Mask bit = Mask(1) << (board[cell].value - 1);
+        board[cell].value = 0;
+        rowUsed[cell / SIZE] &= ~bit;
+        colUsed[cell % SIZE] &= ~bit;
+        boxUsed[box_of(cell)] &= ~bit;
+        for (int peer : TABLES.peers[cell]) {
+            if (ordered[peer]) {
+                order_remove(peer);
+                degree[peer]++;
+                order_insert(peer);
+            }
+        }
+        order_insert(cell);
+    }
+
+    /**
+     * @brief       Change a cell's domain, recording the old domain on the trail
+     * @param cell  The cell to change
+     * @param d     The new domain. Must be a strict subset of the current domain
+     */
+    void set_domain(int cell, Mask d) {
+        STAT_ADD(removals, __builtin_popcount(board[cell].d ^ d));
+        trail[trailSize++] = {cell, board[cell].d};
+        if (ordered[cell]) {
+            order_remove(cell);
+            board[cell].d = d;
+            order_insert(cell);
+        } else {
+            board[cell].d = d;
+        }
+    }
+
+    /**
+     * @brief       Undo domain changes until the trail is back to a previous size
+     * @param mark  The trail size to return to
+     */
+    void undo_to(int mark) {
+        while (trailSize > mark) {
+            trailSize--;
+            int cell = trail[trailSize].cell;
+            if (ordered[cell]) {
+                order_remove(cell);
+                board[cell].d = trail[trailSize].d;
+                order_insert(cell);
+            } else {
+                board[cell].d = trail[trailSize].d;
+            }
+        }
+    }
+
+    /**
+     * @brief               Check if a given value for a cell will violate a rule
+     * @param cell          The cell
+     * @param val           The value to be given.
+     * @return              Returns true if the given value does not violate any rules.
+     *                      Returns false if the given value violates a rules.
+     */
+    bool validate(int cell, int val) const {
+        Mask bit = Mask(1) << (val - 1);
+
+        // Check for a digit overlap within the cell's row, column and box
+        if ((rowUsed[cell / SIZE] | colUsed[cell % SIZE] | boxUsed[box_of(cell)]) & bit) {return false;}
+
+        // Check for heuristic violations between the cell and its assigned neighbors
+        for (int n = 0; n < 4; n++) {
+            int other = TABLES.adjacent[cell][n];
+            if (other == -1 || dots[cell][n] == 0 || board[other].value == 0) {continue;}
+            if (!(TABLES.dotMask[dots[cell][n]][board[other].value] & bit)) {return false;}
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief       Uses minimum remaining value and degree heuristics to find the next unassigned variable to assign a value.
+     *              The smallest domain wins, ties go to the highest degree (unassigned peers plus constraint dots)
+     *              and then to the lowest cell index. Reads the buckets, which are kept up to date as domains change
+     *              and cells are assigned, instead of scanning the board.
+     * @return      The next cell to assign a value, or -1 if every cell is assigned
+     */
+    int find_next() const {
+        for (int size = 1; size <= SIZE; size++) {
+            for (int dw = DEGREE_WORDS - 1; dw >= 0; dw--) {
+                if (usedDegrees[size][dw] == 0) {continue;}
+                const uint64_t* bucket = buckets[size][dw * 64 + 63 - __builtin_clzll(usedDegrees[size][dw])];
+                for (int w = 0; ; w++) {
+                    if (bucket[w]) {return w * 64 + __builtin_ctzll(bucket[w]);}
+                }
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief       Narrow a cell's domain and queue the cell for propagation if it changed
+     * @param cell  The cell to narrow
+     * @param d     The digits the cell may still hold. Intersected with the current domain
+     * @return      False if the cell is left with an empty domain
+     */
+    bool narrow(int cell, Mask d) {
+        d &= board[cell].d;
+        if (d == board[cell].d) {return true;}
+        if (d == 0) {return false;}
+        set_domain(cell, d);
+        if (!queued[cell]) {
+            queued[cell] = true;
+            queue[queueSize++] = cell;
+        }
+        return true;
+    }
+
+    /**
+     * @brief       Hidden singles and naked pairs within one row, column or box
+     * @param unit  The unit to check
+     * @return      False if some digit no longer fits anywhere in the unit or a domain becomes empty
+     */
+    bool propagate_unit(const int (&unit)[SIZE]) {
+        // Digits that fit at least once and at least twice in the unit
+        Mask once = 0, twice = 0;
+        for (int cell : unit) {
+            twice |= once & board[cell].d;
+            once |= board[cell].d;
+        }
+        if (once != ALL) {return false;}
+
+        // A digit that fits in exactly one cell must go there
+        for (Mask single = once & ~twice; single; single &= single - 1) {
+            Mask bit = single & -single;
+            for (int cell : unit) {
+                if ((board[cell].d & bit) && !narrow(cell, bit)) {return false;}
+            }
+        }
+
+        // Two cells sharing the same two candidates take both, so no other cell in the unit may
+        for (int i = 0; i < SIZE; i++) {
+            Mask pair = board[unit[i]].d;
+            if (__builtin_popcount(pair) != 2) {continue;}
+            for (int j = i + 1; j < SIZE; j++) {
+                if (board[unit[j]].d != pair) {continue;}
+                for (int other : unit) {
+                    if (other != unit[i] && other != unit[j] && !narrow(other, ~pair)) {return false;}
+                }
+                break;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief       Constraint propagation - runs the queued domain changes to a fixpoint.
+     *              A cell left with a single digit removes it from its peers, every dot
+     *              limits its neighbor to digits consecutive with (white) or in a 2:1 ratio
+     *              with (black) the cell's remaining digits, and every unit is checked for
+     *              hidden singles and naked pairs once the queue runs dry. Every change is
+     *              recorded on the trail.
+     * @return      True if no cell is left with an empty domain.
+     *              False if some cell is, in which case the queue is cleared and the
+     *              caller undoes the trail.
+     */
+    bool propagate() {
+        bool consistent = true;
+        while (consistent && queueSize > 0) {
+            while (consistent && queueSize > 0) {
+                int cell = queue[--queueSize];
+                queued[cell] = false;
+                Mask d = board[cell].d;
+
+                if (__builtin_popcount(d) == 1) {
+                    for (int peer : TABLES.peers[cell]) {
+                        if (!narrow(peer, ~d)) {consistent = false; break;}
+                    }
+                }
+
+                for (int n = 0; consistent && n < 4; n++) {
+                    if (dots[cell][n] == 0) {continue;}
+                    Mask allowed = 0;
+                    for (Mask rest = d; rest; rest &= rest - 1) {
+                        allowed |= TABLES.dotMask[dots[cell][n]][__builtin_ctz(rest) + 1];
+                    }
+                    if (!narrow(TABLES.adjacent[cell][n], allowed)) {consistent = false;}
+                }
+            }
+
+            for (int u = 0; consistent && u < UNITS; u++) {
+                if (!propagate_unit(TABLES.units[u])) {consistent = false;}
+            }
+        }
+
+        if (!consistent) {
+            while (queueSize > 0) {queued[queue[--queueSize]] = false;}
+        }
+        return consistent;
+    }
+
+    /**
+     * @brief   backtracking search for the puzzle
+     * @return  true if every empty cell has been filled out (success)
+     *          false if a cell cannot be filled out (failure)
+     */
+    bool backtracking_search() {
+        nodes++;
+        if ((cancel && cancel->load(memory_order_relaxed)) || (nodeLimit && nodes > nodeLimit)) {return false;}
+
+        // find next unassigned cell
+        int cell = find_next();
+        // record a solution if no unassigned cells left, and succeed once enough have been found
+        if (cell == -1) return ++solutions >= solutionLimit;
+
+        // otherwise, begin testing values within that cell's domain
+        for (Mask remaining = board[cell].d; remaining; remaining &= remaining - 1) {
+            int val = __builtin_ctz(remaining) + 1;
+            // Validate domain values
+            if (validate(cell, val)) {
+                // Propagate the value and check for domain violations
+                int mark = trailSize;
+                Mask bit = Mask(1) << (val - 1);
+                if (narrow(cell, bit) && propagate()){
+                    // Assigns the value to the cell if no heuristics are violated
+                    assign(cell, val);
+                    STAT_ADD(assignments, 1);
+                    STAT_ADD(depth, 1);
+                    STAT_MAX(maxDepth, stats.depth);
+                    if (backtracking_search()) {return true;}
+                    STAT_ADD(depth, -1);
+                    unassign(cell);
+                }
+
+                // If propagation or recursive search fails, undo every domain change made since
+                STAT_ADD(backtracks, 1);
+                undo_to(mark);
+            }
+        }
+
+        return false;
+    }
+};
+
+/**
+ * @brief Search engines: the propagating backtracking search, or Dancing Links
+ */
+enum class Engine {BACKTRACK, DLX};
+
+/**
+ * @brief       Parse an engine name: backtrack or dlx
+ * @return      False if the name is not an engine
+ */
+bool parse_engine(const string& name, Engine& engine) {
+    if (name == "backtrack") {engine = Engine::BACKTRACK; return true;}
+    if (name == "dlx") {engine = Engine::DLX; return true;}
+    return false;
+}
+
+/**
+ * @brief Dancing Links (Knuth's Algorithm X) engine. The Sudoku rules are an exact cover problem: every
+ *        (cell, digit) candidate is a row covering four columns, one for its cell and one for its digit in
+ *        each of its row, column and box. The dots are side constraints: placing a digit hides the rows of
+ *        each dotted neighbor whose digit is not consecutive with it (white) or in a 2:1 ratio with it (black),
+ *        and digits with no possible partner across a dot are hidden up front. Columns are chosen by fewest
+ *        remaining rows. Sized at run time, so one instance serves every board size and is reused between puzzles
+ */
+struct DancingLinks {
+    /**
+     * @param size          Size of the puzzle (number of rows / columns)
+     * @param box           Size of a box
+     * @param left, right   Horizontal links between the nodes of a row, and between column headers
+     * @param up, down      Vertical links between the nodes of a column and its header
+     * @param column        The column header of each node
+     * @param count         The number of rows still linked into each column
+     * @param rowOf         The candidate row of each node
+     * @param dead          For each row, how many covers and hides have unlinked it. Only rows at 0 may be hidden
+     * @param hidden        Rows hidden by placed digits, undone in reverse order on backtrack
+     * @param dots          The constraint between each cell and its neighbor above, below, left and right
+     * @param value         The digit placed in each cell, or 0
+     * @param nodes         Number of search nodes expanded
+     * @param solutions     Number of solutions found by the search
+     * @param solutionLimit The search stops once it has found this many solutions
+     * @param nodeLimit     When not 0, the search gives up after expanding this many nodes
+     */
+    int size = 0, box = 0;
+    vector<int> left, right, up, down, column, count, rowOf, dead, hidden, value;
+    vector<array<int, 4>> dots;
+    long long nodes = 0, solutions = 0, solutionLimit = 1, nodeLimit = 0;
+
+    static bool compatible(int dot, int a, int b) {
+        if (dot == 1) {return abs(a - b) == 1;}
+        if (dot == 2) {return a == 2 * b || b == 2 * a;}
+        return true;
+    }
+
+    /**
+     * @brief           The cell above, below, left or right of a cell, or -1 at an edge
+     */
+    int neighbor(int cell, int n) const {
+        int row = cell / size, col = cell % size;
+        if (n == 0) {return row > 0 ? cell - size : -1;}
+        if (n == 1) {return row < size - 1 ? cell + size : -1;}
+        if (n == 2) {return col > 0 ? cell - 1 : -1;}
+        return col < size - 1 ? cell + 1 : -1;
+    }
+
+    /**
+     * @brief           First node of a candidate row. The row of (cell, digit) is cell * size + digit - 1
+     */
+    int first_node(int row) const {
+        return 4 * size * size + 1 + 4 * row;
+    }
+
+    void cover(int c) {
+        left[right[c]] = left[c];
+        right[left[c]] = right[c];
+        for (int i = down[c]; i != c; i = down[i]) {
+            dead[rowOf[i]]++;
+            for (int j = right[i]; j != i; j = right[j]) {
+                up[down[j]] = up[j];
+                down[up[j]] = down[j];
+                count[column[j]]--;
+            }
+        }
+    }
+
+    void uncover(int c) {
+        for (int i = up[c]; i != c; i = up[i]) {
+            dead[rowOf[i]]--;
+            for (int j = left[i]; j != i; j = left[j]) {
+                count[column[j]]++;
+                up[down[j]] = j;
+                down[up[j]] = j;
+            }
+        }
+        left[right[c]] = c;
+        right[left[c]] = c;
+    }
+
+    void hide(int row) {
+        dead[row]++;
+        hidden.push_back(row);
+        for (int j = first_node(row); j < first_node(row) + 4; j++) {
+            up[down[j]] = up[j];
+            down[up[j]] = down[j];
+            count[column[j]]--;
+        }
+    }
+
+    void unhide_to(size_t mark) {
+        while (hidden.size() > mark) {
+            int row = hidden.back();
+            hidden.pop_back();
+            for (int j = first_node(row) + 3; j >= first_node(row); j--) {
+                count[column[j]]++;
+                up[down[j]] = j;
+                down[up[j]] = j;
+            }
+            dead[row]--;
+        }
+    }
+
+    /**
+     * @brief           Place a digit: cover the row's columns and hide the incompatible rows of dotted neighbors
+     * @param row       The candidate row. Must be live
+     */
+    void place(int row) {
+        int cell = row / size, digit = row % size + 1;
+        for (int j = first_node(row); j < first_node(row) + 4; j++) {cover(column[j]);}
+        value[cell] = digit;
+        for (int n = 0; n < 4; n++) {
+            int other = neighbor(cell, n);
+            if (other == -1 || dots[cell][n] == 0 || value[other] != 0) {continue;}
+            for (int e = 1; e <= size; e++) {
+                int otherRow = other * size + e - 1;
+                if (dead[otherRow] == 0 && !compatible(dots[cell][n], digit, e)) {hide(otherRow);}
+            }
+        }
+    }
+
+    /**
+     * @brief           Take back the last place()
+     */
+    void unplace(int row, size_t mark) {
+        unhide_to(mark);
+        value[row / size] = 0;
+        for (int j = first_node(row) + 3; j >= first_node(row); j--) {uncover(column[j]);}
+    }
+
+    /**
+     * @brief           Build the links for a puzzle and place its givens
+     * @param boxSize   Size of a box
+     * @param givens    The given digit of each cell, or 0
+     * @param cellDots  The constraint between each cell and its neighbor above, below, left and right
+     * @return          False if the givens already conflict
+     */
+    bool build(int boxSize, const vector<int>& givens, const vector<array<int, 4>>& cellDots) {
+        box = boxSize;
+        size = box * box;
+        int cells = size * size, columns = 4 * cells, rows = cells * size;
+        int total = columns + 1 + 4 * rows;
+        left.assign(total, 0); right.assign(total, 0); up.assign(total, 0); down.assign(total, 0);
+        column.assign(total, 0); count.assign(columns + 1, 0); rowOf.assign(total, -1);
+        dead.assign(rows, 0); value.assign(cells, 0);
+        hidden.clear();
+        dots = cellDots;
+        nodes = 0;
+        solutions = 0;
+
+        // Header 0 is the root; columns 1 .. 4 * cells hang off it
+        for (int c = 0; c <= columns; c++) {
+            left[c] = c == 0 ? columns : c - 1;
+            right[c] = c == columns ? 0 : c + 1;
+            up[c] = down[c] = c;
+        }
+        for (int row = 0; row < rows; row++) {
+            int cell = row / size, d = row % size, r = cell / size, c = cell % size, b = r / box * box + c / box;
+            int columnsOfRow[4] = {1 + cell, 1 + cells + r * size + d, 1 + 2 * cells + c * size + d, 1 + 3 * cells + b * size + d};
+            for (int k = 0; k < 4; k++) {
+                int node = first_node(row) + k, col = columnsOfRow[k];
+                left[node] = k == 0 ? node + 3 : node - 1;
+                right[node] = k == 3 ? node - 3 : node + 1;
+                column[node] = col;
+                rowOf[node] = row;
+                up[node] = up[col];
+                down[node] = col;
+                down[up[col]] = node;
+                up[col] = node;
+                count[col]++;
+            }
+        }
+
+        // Digits with no partner across one of their dots can never be placed
+        for (int cell = 0; cell < cells; cell++) {
+            for (int d = 1; d <= size; d++) {
+                bool possible = true;
+                for (int n = 0; n < 4 && possible; n++) {
+                    if (dots[cell][n] == 0) {continue;}
+                    possible = false;
+                    for (int e = 1; e <= size && !possible; e++) {possible = compatible(dots[cell][n], d, e);}
+                }
+                if (!possible) {hide(cell * size + d - 1);}
+            }
+        }
+
+        for (int cell = 0; cell < cells; cell++) {
+            if (givens[cell] == 0) {continue;}
+            int row = cell * size + givens[cell] - 1;
+            if (dead[row] != 0) {return false;}
+            place(row);
+        }
+        hidden.clear();
+        return true;
+    }
+
+    /**
+     * @brief   Algorithm X search
+     * @return  true once solutionLimit solutions have been found, with the last one left in value
+     */
+    bool search() {
+        nodes++;
+        if (nodeLimit && nodes > nodeLimit) {return false;}
+        if (right[0] == 0) {return ++solutions >= solutionLimit;}
+
+        // Choose the column with the fewest remaining rows
+        int best = right[0];
+        for (int c = right[best]; c != 0; c = right[c]) {
+            if (count[c] < count[best]) {best = c;}
+        }
+        if (count[best] == 0) {return false;}
+
+        for (int i = down[best]; i != best; i = down[i]) {
+            int row = rowOf[i];
+            size_t mark = hidden.size();
+            place(row);
+            if (search()) {return true;}
+            unplace(row, mark);
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief               Solve or count a puzzle with Dancing Links. A solution is copied onto the solver's board
+ * @param solver        The puzzle, as read. Receives the solution and the number of nodes expanded. Its node
+ *                      limit applies
+ * @param dlx           The engine
+ * @param limit         Stop once this many solutions have been found
+ * @return              The number of solutions found, at most limit
+ */
+template <int B>
+long long solve_dlx(KropkiSolver<B>& solver, DancingLinks& dlx, long long limit) {
+    constexpr int CELLS = KropkiSolver<B>::CELLS;
+    vector<int> givens(CELLS);
+    vector<array<int, 4>> dots(CELLS);
+    for (int cell = 0; cell < CELLS; cell++) {
+        givens[cell] = solver.board[cell].value;
+        for (int n = 0; n < 4; n++) {dots[cell][n] = solver.dots[cell][n];}
+    }
+
+    dlx.solutionLimit = limit;
+    dlx.nodeLimit = solver.nodeLimit;
+    if (dlx.build(B, givens, dots)) {dlx.search();}
+    solver.nodes = dlx.nodes;
+    if (limit == 1 && dlx.solutions == 1) {
+        for (int cell = 0; cell < CELLS; cell++) {solver.board[cell].value = dlx.value[cell];}
+    }
+    return dlx.solutions;
+}
+
+/**
+ * @brief               Solve a puzzle with the chosen engine
+ * @return              True if a solution was found, in which case it is left on the solver's board
+ */
+template <int B>
+bool solve_with(KropkiSolver<B>& solver, Engine engine, DancingLinks& dlx) {
+    if (engine == Engine::DLX) {return solve_dlx(solver, dlx, 1) == 1;}
+    return solver.solve();
+}
+
+/**
+ * @brief One lazily created solver per board size and a Dancing Links engine, owned by a single thread
+ */
+struct SolverSet {
+    tuple<unique_ptr<KropkiSolver<2>>, unique_ptr<KropkiSolver<3>>, unique_ptr<KropkiSolver<4>>, unique_ptr<KropkiSolver<5>>> solvers;
+    DancingLinks dlx;
+
+    template <int B>
+    KropkiSolver<B>& get() {
+        auto& solver = std::get<B - 2>(solvers);
+        if (!solver) {solver = make_unique<KropkiSolver<B>>();}
+        return *solver;
+    }
+};
+
+/**
+ * @brief       Number of values on a line
+ */
+int count_values(const string& line) {
+    istringstream values(line);
+    int count = 0;
+    for (string value; values >> value; ) {count++;}
+    return count;
+}
+
+/**
+ * @brief               Read one puzzle record: the givens, then the horizontal and vertical constraints,
+ *                      in any layout. The board size is the number of values on the record's first line
+ * @param input         The stream to read from. Blank lines before the record are skipped
+ * @param record        Receives the text of the record
+ * @return              False if the stream holds no further record
+ */
+bool read_record(istream& input, string& record) {
+    string line;
+    int size = 0;
+    while (size == 0 && getline(input, line)) {size = count_values(line);}
+    if (size == 0) {return false;}
+
+    record = line + "\n";
+    int missing = 3 * size * size - 2 * size - size;
+    while (missing > 0 && getline(input, line)) {
+        missing -= count_values(line);
+        record += line + "\n";
+    }
+    return true;
+}
+
+/**
+ * @brief               Solve one puzzle record
+ * @param record        The puzzle, as read by read_record()
+ * @param solvers       The calling thread's solvers
+ * @param engine        The search engine
+ * @param result        Receives the solved board followed by a blank line, or "No solution"
+ * @return              True if the puzzle was solved
+ */
+template <int B>
+bool solve_record(istringstream& record, SolverSet& solvers, Engine engine, string& result) {
+    KropkiSolver<B>& solver = solvers.get<B>();
+    ostringstream output;
+    bool solved = solver.read(record) && solve_with(solver, engine, solvers.dlx);
+    if (solved) {solver.write(output);}
+    else {output << "No solution\n";}
+    output << "\n";
+    result = output.str();
+    return solved;
+}
+
+bool solve_record(const string& text, SolverSet& solvers, Engine engine, string& result) {
+    istringstream record(text);
+    switch (count_values(text.substr(0, text.find('\n')))) {
+        case 4: return solve_record<2>(record, solvers, engine, result);
+        case 9: return solve_record<3>(record, solvers, engine, result);
+        case 16: return solve_record<4>(record, solvers, engine, result);
+        case 25: return solve_record<5>(record, solvers, engine, result);
+        default: result = "No solution\n\n"; return false;
+    }
+}
+
+/**
+ * @brief               Run tasks 0 .. count - 1 on a number of threads. Each thread starts on its own contiguous
+ *                      share of the tasks, in order, and steals from the back of another thread's share when it
+ *                      runs out
+ * @param count         Number of tasks
+ * @param threadCount   Number of threads, including the calling thread
+ * @param task          Called with the worker id and the task index
+ */
+void run_parallel(size_t count, int threadCount, const function<void(int, size_t)>& task) {
+    struct WorkQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+    vector<WorkQueue> queues(threadCount);
+    for (size_t i = 0; i < count; i++) {queues[i * threadCount / count].tasks.push_back(i);}
+
+    auto worker = [&](int id) {
+        while (true) {
+            size_t next = 0;
+            bool found = false;
+            {
+                lock_guard<mutex> guard(queues[id].lock);
+                if (!queues[id].tasks.empty()) {
+                    next = queues[id].tasks.front();
+                    queues[id].tasks.pop_front();
+                    found = true;
+                }
+            }
+            for (int offset = 1; !found && offset < threadCount; offset++) {
+                WorkQueue& victim = queues[(id + offset) % threadCount];
+                lock_guard<mutex> guard(victim.lock);
+                if (!victim.tasks.empty()) {
+                    next = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    found = true;
+                }
+            }
+            // no tasks are added once the workers start, so empty queues everywhere means we are done
+            if (!found) {return;}
+            task(id, next);
+        }
+    };
+
+    vector<thread> threads;
+    for (int id = 1; id < threadCount; id++) {threads.emplace_back(worker, id);}
+    worker(0);
+    for (thread& t : threads) {t.join();}
+}
+
+/**
+ * @brief               Solve one puzzle on several threads. The top of the search tree is expanded breadth first,
+ *                      in the order the sequential search would visit it, until there are SPLIT_TASKS subproblems
+ *                      per thread. Each subproblem is the list of decisions leading to it; workers replay it on
+ *                      their own copy of the propagated puzzle and search below it. The first worker to find a
+ *                      solution cancels the rest
+ * @param solver        The puzzle, as read. Receives the solution, and the nodes expanded by every worker
+ * @param threadCount   Number of worker threads
+ * @return              True if a solution was found
+ */
+template <int B>
+bool solve_parallel(KropkiSolver<B>& solver, int threadCount) {
+    using Path = vector<pair<int, int>>;
+    if (!solver.prepare()) {return false;}
+
+    // Split the tree. Paths that already solve the puzzle are kept as they are; dead ends are dropped
+    vector<Path> tasks(1), children;
+    auto scratch = make_unique<KropkiSolver<B>>();
+    long long splitNodes = 0;
+    bool expanded = true;
+    while (expanded && !tasks.empty() && tasks.size() < SPLIT_TASKS * threadCount) {
+        expanded = false;
+        children.clear();
+        for (const Path& path : tasks) {
+            *scratch = solver;
+            scratch->apply(path);
+            splitNodes++;
+            int cell = scratch->find_next();
+            if (cell == -1) {
+                children.push_back(path);
+                continue;
+            }
+            expanded = true;
+            for (auto remaining = scratch->board[cell].d; remaining; remaining &= remaining - 1) {
+                int val = __builtin_ctz(remaining) + 1;
+                int mark = scratch->trailSize;
+                if (scratch->validate(cell, val) && scratch->narrow(cell, remaining & -remaining) && scratch->propagate()) {
+                    children.push_back(path);
+                    children.back().push_back({cell, val});
+                }
+                scratch->undo_to(mark);
+            }
+        }
+        swap(tasks, children);
+    }
+
+    // Search the subproblems
+    atomic<bool> found(false);
+    atomic<long long> nodes(splitNodes);
+    int winner = -1;
+    vector<unique_ptr<KropkiSolver<B>>> workers(threadCount);
+    run_parallel(tasks.size(), threadCount, [&](int worker, size_t task) {
+        if (found) {return;}
+        if (!workers[worker]) {workers[worker] = make_unique<KropkiSolver<B>>();}
+        KropkiSolver<B>& local = *workers[worker];
+        local = solver;
+        local.cancel = &found;
+        bool solved = local.apply(tasks[task]) && local.backtracking_search();
+        nodes += local.nodes;
+        if (solved && !found.exchange(true)) {winner = worker;}
+    });
+
+    if (winner == -1) {return false;}
+    solver = *workers[winner];
+    solver.cancel = nullptr;
+    solver.nodes = nodes;
+    return true;
+}
+
+/**
+ * @brief               Solve every puzzle in a stream. Records are read BATCH_RECORDS at a time, solved in
+ *                      parallel with one solver set per thread, and written in input order before the next
+ *                      records are read, so memory stays bounded however long the stream is
+ * @param input         The stream puzzles are read from
+ * @param output        The stream solutions are written to
+ * @param threadCount   Number of worker threads
+ * @param engine        The search engine
+ */
+void solve_batch(istream& input, ostream& output, int threadCount, Engine engine) {
+    vector<SolverSet> solvers(threadCount);
+    vector<string> records, results;
+    atomic<size_t> solved(0);
+    size_t total = 0;
+
+    auto started = chrono::steady_clock::now();
+    while (true) {
+        records.clear();
+        string record;
+        while (records.size() < BATCH_RECORDS && read_record(input, record)) {records.push_back(record);}
+        if (records.empty()) {break;}
+
+        results.assign(records.size(), string());
+        run_parallel(records.size(), threadCount, [&](int worker, size_t i) {
+            if (solve_record(records[i], solvers[worker], engine, results[i])) {solved++;}
+        });
+        for (const string& result : results) {output << result;}
+        output.flush();
+        total += records.size();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    cerr << total << " puzzles (" << solved << " solved) on " << threadCount << " threads in " << seconds << " s ("
+         << (seconds > 0 ? total / seconds : 0) << " puzzles/sec)\n";
+}
+
+/**
+ * @brief               Make a random solution grid by shuffling the rows within each band, the bands, the columns
+ *                      within each stack, the stacks and the digits of a pattern grid
+ * @param rng           Random source
+ * @return              The digit of each cell, row by row
+ */
+template <int B>
+vector<int> random_solution(mt19937& rng) {
+    constexpr int SIZE = KropkiSolver<B>::SIZE;
+    auto shuffled_lines = [&]() {
+        vector<int> groups(B), lines;
+        iota(groups.begin(), groups.end(), 0);
+        shuffle(groups.begin(), groups.end(), rng);
+        for (int group : groups) {
+            vector<int> inner(B);
+            iota(inner.begin(), inner.end(), 0);
+            shuffle(inner.begin(), inner.end(), rng);
+            for (int line : inner) {lines.push_back(group * B + line);}
+        }
+        return lines;
+    };
+    vector<int> rows = shuffled_lines(), cols = shuffled_lines(), digits(SIZE);
+    iota(digits.begin(), digits.end(), 1);
+    shuffle(digits.begin(), digits.end(), rng);
+
+    vector<int> solution(SIZE * SIZE);
+    for (int r = 0; r < SIZE; r++) {
+        for (int c = 0; c < SIZE; c++) {
+            solution[r * SIZE + c] = digits[(B * (rows[r] % B) + rows[r] / B + cols[c]) % SIZE];
+        }
+    }
+    return solution;
+}
+
+/**
+ * @brief               The dots a solution implies between each cell and its lower (n = 1) and right (n = 3) neighbors
+ * @param solution      The digit of each cell
+ * @return              The dot of cell c towards neighbor n at c * 4 + n. Entries for n = 0 and 2 are 0
+ */
+template <int B>
+vector<int> implied_dots(const vector<int>& solution) {
+    constexpr int CELLS = KropkiSolver<B>::CELLS;
+    vector<int> dots(CELLS * 4, 0);
+    for (int cell = 0; cell < CELLS; cell++) {
+        for (int n : {1, 3}) {
+            int other = KropkiSolver<B>::TABLES.adjacent[cell][n];
+            if (other == -1) {continue;}
+            int a = solution[cell], b = solution[other];
+            dots[cell * 4 + n] = (a == 2 * b || b == 2 * a) ? 2 : (abs(a - b) == 1 ? 1 : 0);
+        }
+    }
+    return dots;
+}
+
+/**
+ * @brief               Write a puzzle in the input format: givens, horizontal and vertical constraints, each section
+ *                      followed by a blank line
+ * @param givens        The given digit of each cell, or 0
+ * @param dots          The dots, laid out as by implied_dots()
+ */
+template <int B>
+string format_puzzle(const vector<int>& givens, const vector<int>& dots) {
+    constexpr int SIZE = KropkiSolver<B>::SIZE;
+    ostringstream puzzle;
+    for (int r = 0; r < SIZE; r++) {
+        for (int c = 0; c < SIZE; c++) {puzzle << givens[r * SIZE + c] << (c < SIZE - 1 ? " " : "\n");}
+    }
+    puzzle << "\n";
+    for (int r = 0; r < SIZE; r++) {
+        for (int c = 0; c < SIZE - 1; c++) {puzzle << dots[(r * SIZE + c) * 4 + 3] << (c < SIZE - 2 ? " " : "\n");}
+    }
+    puzzle << "\n";
+    for (int r = 0; r < SIZE - 1; r++) {
+        for (int c = 0; c < SIZE; c++) {puzzle << dots[(r * SIZE + c) * 4 + 1] << (c < SIZE - 1 ? " " : "\n");}
+    }
+    puzzle << "\n";
+    return puzzle.str();
+}
+
+/**
+ * @param GENERATE_NODE_LIMIT   Nodes a single uniqueness check in generate_puzzle() may expand. Checks on 4x4
+ *                              and 9x9 boards stay far below it. On one core a 16x16 puzzle takes a few
+ *                              seconds, a 25x25 one about half an hour, as most of its checks run out of nodes
+ */
+const long long GENERATE_NODE_LIMIT = 100000;
+
+/**
+ * @brief               Generate a puzzle with a unique solution. Starting from a random_solution() with every
+ *                      given and every dot it implies, givens and dots are removed in random order, each removal
+ *                      kept only if the puzzle still has exactly one solution. Uniqueness checks stop at the
+ *                      second solution, or after GENERATE_NODE_LIMIT nodes, in which case the removal is undone
+ *                      as if the check had found a second solution. The puzzle stays unique, but on larger boards
+ *                      may keep givens a complete check would have removed
+ * @param solver        Solver used for the uniqueness checks. Its nodeLimit is restored on return
+ * @param seed          Seed for the random choices. The same seed always gives the same puzzle
+ * @return              The puzzle in the input format, see format_puzzle()
+ */
+template <int B>
+string generate_puzzle(KropkiSolver<B>& solver, unsigned seed) {
+    constexpr int CELLS = KropkiSolver<B>::CELLS;
+    mt19937 rng(seed);
+
+    vector<int> givens = random_solution<B>(rng);
+    vector<int> dots = implied_dots<B>(givens);
+    vector<int> items;
+    for (int cell = 0; cell < CELLS; cell++) {
+        items.push_back(cell);
+        for (int n : {1, 3}) {
+            if (dots[cell * 4 + n] != 0) {items.push_back(CELLS + cell * 4 + n);}
+        }
+    }
+    shuffle(items.begin(), items.end(), rng);
+
+    auto unique = [&]() {
+        solver.reset();
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (givens[cell] != 0) {solver.give(cell, givens[cell]);}
+            for (int n : {1, 3}) {
+                if (dots[cell * 4 + n] != 0) {solver.set_dot(cell, n, dots[cell * 4 + n]);}
+            }
+        }
+        return solver.count_solutions(2) == 1 && solver.nodes <= GENERATE_NODE_LIMIT;
+    };
+    long long nodeLimit = solver.nodeLimit;
+    solver.nodeLimit = GENERATE_NODE_LIMIT;
+    for (int item : items) {
+        int& slot = item < CELLS ? givens[item] : dots[item - CELLS];
+        int removed = slot;
+        slot = 0;
+        if (!unique()) {slot = removed;}
+    }
+    solver.nodeLimit = nodeLimit;
+
+    return format_puzzle<B>(givens, dots);
+}
+
+/**
+ * @brief               Generate puzzles with unique solutions on several threads, BATCH_RECORDS at a time,
+ *                      and write them in order. Puzzle i uses seed + i, so the output does not depend on the
+ *                      number of threads
+ * @param output        The stream puzzles are written to
+ * @param count         Number of puzzles
+ * @param seed          Seed of the first puzzle
+ * @param threadCount   Number of worker threads
+ */
+template <int B>
+void generate_puzzles(ostream& output, size_t count, unsigned seed, int threadCount) {
+    vector<unique_ptr<KropkiSolver<B>>> solvers(threadCount);
+    vector<string> puzzles;
+
+    auto started = chrono::steady_clock::now();
+    for (size_t first = 0; first < count; first += BATCH_RECORDS) {
+        puzzles.assign(min(BATCH_RECORDS, count - first), string());
+        run_parallel(puzzles.size(), threadCount, [&](int worker, size_t i) {
+            if (!solvers[worker]) {solvers[worker] = make_unique<KropkiSolver<B>>();}
+            puzzles[i] = generate_puzzle(*solvers[worker], seed + unsigned(first + i));
+        });
+        for (const string& puzzle : puzzles) {output << puzzle;}
+        output.flush();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    cerr << count << " puzzles generated on " << threadCount << " threads in " << seconds << " s ("
+         << (seconds > 0 ? count / seconds : 0) << " puzzles/sec)\n";
+}
+
+/**
+ * @brief Benchmark corpus entry: puzzles of one board size and difficulty
+ * @param name      Name of the case in the report
+ * @param box       Box size
+ * @param givens    Fraction of the solution kept as givens, with every dot the solution implies.
+ *                  Negative for minimal puzzles from generate_puzzle(), which are the hardest
+ * @param count     Number of puzzles
+ */
+struct BenchCase {
+    const char* name;
+    int box;
+    double givens;
+    int count;
+};
+
+/**
+ * @param BENCH_CASES       Puzzles solved by --bench, graded from easy to hard within each board size
+ * @param BENCH_NODE_LIMIT  Nodes a benchmark puzzle may expand before the engine gives up on it, so a slow
+ *                          engine cannot stall the run. Puzzles given up on are reported
+ */
+const BenchCase BENCH_CASES[] = {
+    {"4x4-minimal", 2, -1, 100},
+    {"9x9-givens40", 3, 0.4, 100},
+    {"9x9-givens20", 3, 0.2, 100},
+    {"9x9-minimal", 3, -1, 100},
+    {"16x16-givens50", 4, 0.5, 20},
+    {"16x16-givens30", 4, 0.3, 20},
+    {"16x16-givens20", 4, 0.2, 10},
+    {"25x25-givens50", 5, 0.5, 5},
+};
+const long long BENCH_NODE_LIMIT = 1000000;
+
+/**
+ * @return      Peak resident set size of the process so far, in kilobytes
+ */
+long peak_memory_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief       Write search counters as a JSON object
+ */
+void write_stats(ostream& out, const SolverStats& stats) {
+    out << "{\"assignments\": " << stats.assignments << ", \"backtracks\": " << stats.backtracks
+        << ", \"removals\": " << stats.removals << ", \"max_depth\": " << stats.maxDepth << "}";
+}
+
+/**
+ * @brief               Generate one benchmark case's puzzles and solve them repeat times, writing one JSON object.
+ *                      Puzzles come from the seed, so runs with the same seed solve exactly the same puzzles.
+ *                      Only the solving is timed; the minimum and median over the repeats are reported.
+ *                      Builds with -DSOLVER_STATS add the backtracking search's counters of the last repeat
+ * @param out           The stream the JSON object is written to
+ * @param bench         The case
+ * @param seed          Seed of the case's first puzzle
+ * @param repeat        Number of times the puzzles are solved
+ * @param engine        The search engine
+ */
+template <int B>
+void run_bench_case(ostream& out, const BenchCase& bench, unsigned seed, int repeat, Engine engine) {
+    constexpr int CELLS = KropkiSolver<B>::CELLS;
+    auto solver = make_unique<KropkiSolver<B>>();
+    DancingLinks dlx;
+
+    vector<string> puzzles;
+    for (int i = 0; i < bench.count; i++) {
+        if (bench.givens < 0) {
+            puzzles.push_back(generate_puzzle(*solver, seed + i));
+            continue;
+        }
+        mt19937 rng(seed + i);
+        vector<int> givens = random_solution<B>(rng);
+        vector<int> dots = implied_dots<B>(givens);
+        bernoulli_distribution keep(bench.givens);
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (!keep(rng)) {givens[cell] = 0;}
+        }
+        puzzles.push_back(format_puzzle<B>(givens, dots));
+    }
+    solver->nodeLimit = BENCH_NODE_LIMIT;
+
+    vector<double> times;
+    long long nodes = 0;
+    int solved = 0, gaveUp = 0;
+    SolverStats total;
+    for (int r = 0; r < repeat; r++) {
+        double elapsed = 0;
+        nodes = 0;
+        solved = gaveUp = 0;
+        total = SolverStats();
+        for (const string& puzzle : puzzles) {
+            istringstream record(puzzle);
+            solver->read(record);
+            auto started = chrono::steady_clock::now();
+            if (solve_with(*solver, engine, dlx)) {solved++;}
+            elapsed += chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+            nodes += solver->nodes;
+            if (solver->nodes > BENCH_NODE_LIMIT) {gaveUp++;}
+            total.assignments += solver->stats.assignments;
+            total.backtracks += solver->stats.backtracks;
+            total.removals += solver->stats.removals;
+            total.maxDepth = max(total.maxDepth, solver->stats.maxDepth);
+        }
+        times.push_back(elapsed);
+    }
+    sort(times.begin(), times.end());
+
+    out << "\n  {\"name\": \"" << bench.name << "\", \"size\": " << B * B << ", \"puzzles\": " << bench.count
+        << ", \"solved\": " << solved << ", \"gave_up\": " << gaveUp << ", \"time_ms_min\": " << times.front()
+        << ", \"time_ms_median\": " << times[times.size() / 2] << ", \"nodes\": " << nodes
+        << ", \"peak_rss_kb\": " << peak_memory_kb();
+    if (SOLVER_STATS_ENABLED && engine == Engine::BACKTRACK) {
+        out << ", \"stats\": ";
+        write_stats(out, total);
+    }
+    out << "}";
+    out.flush();
+}
+
+/**
+ * @brief       FNV-1a hash of a case name, so each case's puzzles stay the same when cases are added or reordered
+ */
+unsigned name_hash(const char* name) {
+    unsigned hash = 2166136261u;
+    for (; *name; name++) {hash = (hash ^ uint8_t(*name)) * 16777619u;}
+    return hash;
+}
+
+/**
+ * @brief       Run part of the benchmark in a child process, so that peak_memory_kb() there measures that part
+ *              alone instead of the largest case run so far. Runs it in this process if no child can be started
+ * @param body  Writes its results to the given stream
+ * @return      What body wrote
+ */
+string run_isolated(const function<void(ostream&)>& body) {
+    ostringstream text;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        body(text);
+        return text.str();
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        body(text);
+        return text.str();
+    }
+    if (child == 0) {
+        close(fds[0]);
+        body(text);
+        string result = text.str();
+        for (size_t sent = 0; sent < result.size();) {
+            ssize_t written = write(fds[1], result.data() + sent, result.size() - sent);
+            if (written <= 0) {break;}
+            sent += written;
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    string result;
+    char buffer[4096];
+    for (ssize_t got; (got = read(fds[0], buffer, sizeof(buffer))) > 0;) {result.append(buffer, got);}
+    close(fds[0]);
+    waitpid(child, nullptr, 0);
+    return result;
+}
+
+/**
+ * @brief               Run the benchmark corpus and write the results as JSON. Each case runs in its own child
+ *                      process, so its peak_rss_kb is the peak memory of that case alone
+ * @param out           The stream the JSON document is written to
+ * @param seed          Seed of the corpus
+ * @param repeat        Number of times each case is solved
+ * @param engine        The search engine
+ */
+void run_benchmark(ostream& out, unsigned seed, int repeat, Engine engine) {
+    out << "{\"program\": \"Project2\", \"engine\": \"" << (engine == Engine::DLX ? "dlx" : "backtrack")
+        << "\", \"seed\": " << seed << ", \"repeat\": " << repeat << ", \"cases\": [";
+    int index = 0;
+    for (const BenchCase& bench : BENCH_CASES) {
+        if (index > 0) {out << ",";}
+        unsigned caseSeed = seed + name_hash(bench.name);
+        index++;
+        out << run_isolated([&](ostream& caseOut) {
+            switch (bench.box) {
+                case 2: run_bench_case<2>(caseOut, bench, caseSeed, repeat, engine); break;
+                case 3: run_bench_case<3>(caseOut, bench, caseSeed, repeat, engine); break;
+                case 4: run_bench_case<4>(caseOut, bench, caseSeed, repeat, engine); break;
+                case 5: run_bench_case<5>(caseOut, bench, caseSeed, repeat, engine); break;
+            }
+        });
+        out.flush();
+    }
+    out << "\n]}\n";
+}
+
+/**
+ * @brief               Solve one puzzle with B x B boxes
+ * @param input         The stream holding the puzzle
+ * @param outputFile    The file to write the solution to
+ * @param threadCount   Number of threads to split the search over, or 1 for the sequential search
+ * @param countLimit    If not 0, count the solutions up to this many instead of solving
+ * @param engine        The search engine. --parallel always uses the backtracking search
+ */
+template <int B>
+void solve_puzzle(istream& input, const string& outputFile, int threadCount, long long countLimit, Engine engine) {
+    auto solver = make_unique<KropkiSolver<B>>();
+    DancingLinks dlx;
+    solver->read(input);
+
+    if (countLimit > 0) {
+        long long solutions = engine == Engine::DLX ? solve_dlx(*solver, dlx, countLimit) : solver->count_solutions(countLimit);
+        cout << "Found " << solutions << (solutions == 1 ? " solution" : " solutions")
+             << (solutions >= countLimit ? " (stopped at the limit)" : "") << " in " << solver->nodes << " nodes" << endl;
+    }
+    // Initialize the search. Output if a solution is found.
+    else if (threadCount > 1 ? solve_parallel(*solver, threadCount) : solve_with(*solver, engine, dlx)){
+        cout << "Solved in " << solver->nodes << " nodes. Output to " << outputFile << endl;
+
+        ofstream output(outputFile);
+        solver->write(output);
+        output.close();
+    }
+
+    // The counters of a parallel search only cover the winning subtree, so they are reported for the sequential search alone
+    if (SOLVER_STATS_ENABLED && engine == Engine::BACKTRACK && (countLimit > 0 || threadCount == 1)) {
+        cerr << "Search stats: ";
+        write_stats(cerr, solver->stats);
+        cerr << endl;
+    }
+}
+
+/**
+ * @brief       sudoku solver. The board size (4, 9, 16 or 25) is taken from the number of values on the first line
+ * @param argv  optional arguments: -i <input file> -o <output file>
+ *              --batch solves every puzzle in the input, one record after another, and writes the solutions
+ *              in the same order. Reads stdin and writes stdout unless -i / -o are given
+ *              --parallel splits the search for a single puzzle over --threads threads
+ *              --count <n> counts the puzzle's solutions, stopping at n, instead of solving it
+ *              --generate <n> writes n puzzles with unique solutions, in the input format, to stdout or -o
+ *              --box <b> box size of generated puzzles (2 to 5), default 3. Sizes 2 to 4 are practical, see
+ *              GENERATE_NODE_LIMIT
+ *              --seed <s> seed of the first generated puzzle, and of the --bench corpus, default 1
+ *              --threads <n> number of worker threads for --batch, --parallel and --generate, default all cores
+ *              --engine <backtrack|dlx> search engine for solving and counting, default backtrack. dlx is
+ *              Dancing Links with the dots applied as side constraints
+ *              --bench solves a generated corpus of graded puzzles with the chosen engine and writes timings,
+ *              node counts and peak memory as JSON to stdout
+ *              --repeat <n> number of times each benchmark case is solved, default 3
+ *              Builds with -DSOLVER_STATS print the backtracking search's counters to cerr, and add them to --bench
+ * @return      Prints output to specified text file
+ */
+int main(int argc, char* argv[]) {
+    string inputFile = INPUTFILE; // Replace with actual input file
+    string outputFile = OUTPUTFILE;
+    bool inputGiven = false, outputGiven = false, batch = false, parallel = false;
+    int threadCount = max(1u, thread::hardware_concurrency());
+    long long countLimit = 0, generateCount = 0;
+    int box = 3, repeat = 3;
+    bool bench = false;
+    unsigned seed = 1;
+    Engine engine = Engine::BACKTRACK;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 < argc && arg == "-i") {inputFile = argv[++i]; inputGiven = true;}
+        else if (i + 1 < argc && arg == "-o") {outputFile = argv[++i]; outputGiven = true;}
+        else if (i + 1 < argc && arg == "--threads") {threadCount = max(1, atoi(argv[++i]));}
+        else if (i + 1 < argc && arg == "--count") {countLimit = max(1LL, atoll(argv[++i]));}
+        else if (i + 1 < argc && arg == "--generate") {generateCount = max(0LL, atoll(argv[++i]));}
+        else if (i + 1 < argc && arg == "--box") {box = atoi(argv[++i]);}
+        else if (i + 1 < argc && arg == "--seed") {seed = strtoul(argv[++i], nullptr, 10);}
+        else if (i + 1 < argc && arg == "--engine" && parse_engine(argv[i + 1], engine)) {i++;}
+        else if (i + 1 < argc && arg == "--repeat") {repeat = max(1, atoi(argv[++i]));}
+        else if (arg == "--batch") {batch = true;}
+        else if (arg == "--bench") {bench = true;}
+        else if (arg == "--parallel") {parallel = true;}
+        else {
+            cerr << "Usage: " << argv[0] << " [-i input] [-o output] [--batch | --parallel | --count n]"
+                 << " [--generate n [--box b] [--seed s]] [--threads n] [--engine backtrack|dlx]"
+                 << " [--bench [--seed s] [--repeat n]]\n";
+            return 1;
+        }
+    }
+
+    if (bench) {
+        run_benchmark(cout, seed, repeat, engine);
+        return 0;
+    }
+
+    if (generateCount > 0 && (box < 2 || box > 5)) {
+        cerr << "Unsupported box size " << box << " (expected 2 to 5)\n";
+        return 1;
+    }
+
+    if (batch || generateCount > 0) {
+        ifstream inputStream;
+        ofstream outputStream;
+        if (inputGiven) {inputStream.open(inputFile);}
+        if (outputGiven) {outputStream.open(outputFile);}
+        if ((inputGiven && !inputStream) || (outputGiven && !outputStream)) {
+            cerr << "Could not open " << (inputGiven && !inputStream ? inputFile : outputFile) << "\n";
+            return 1;
+        }
+        ostream& output = outputGiven ? static_cast<ostream&>(outputStream) : cout;
+        switch (generateCount > 0 ? box : 0) {
+            case 2: generate_puzzles<2>(output, generateCount, seed, threadCount); break;
+            case 3: generate_puzzles<3>(output, generateCount, seed, threadCount); break;
+            case 4: generate_puzzles<4>(output, generateCount, seed, threadCount); break;
+            case 5: generate_puzzles<5>(output, generateCount, seed, threadCount); break;
+            default: solve_batch(inputGiven ? inputStream : cin, output, threadCount, engine); break;
+        }
+        return 0;
+    }
+
+    ifstream input(inputFile);
+
+    string firstLine;
+    getline(input, firstLine);
+    int size = count_values(firstLine);
+    input.seekg(0);
+
+    if (!parallel) {threadCount = 1;}
+    switch (size) {
+        case 4: solve_puzzle<2>(input, outputFile, threadCount, countLimit, engine); break;
+        case 9: solve_puzzle<3>(input, outputFile, threadCount, countLimit, engine); break;
+        case 16: solve_puzzle<4>(input, outputFile, threadCount, countLimit, engine); break;
+        case 25: solve_puzzle<5>(input, outputFile, threadCount, countLimit, engine); break;
+        default: cerr << "Unsupported board size " << size << " (expected 4, 9, 16 or 25)" << endl; break;
+    }
+    input.close();
+
+    cout << "Program Finished";
+
+}
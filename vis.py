@@ -1,47 +1,129 @@
-import numpy as np
-import matplotlib.pyplot as plt
-from matplotlib.patches import Rectangle
-import sys
-
-def plot_maze(file_path):
-    try:
-        # Load the maze from the .txt file
-        with open(file_path, "r") as file:
-            maze = np.loadtxt(file_path, delimiter=" ", usecols=range(50))
-
-        # Initialize the plot
-        fig, ax = plt.subplots(figsize=(12, 7))
-        nrows, ncols = maze.shape
-
-        # Define colors for each tile type
-        colors = {0: "white", 1: "black", 2: "red", 3: "white", 4: "yellow", 5: "green"}
-
-        # Plot each tile
-        for row in range(nrows):
-            for col in range(ncols):
-                tile_color = colors.get(
-                    maze[row, col], "white"
-                )  # Default to white if unknown
-                rect = Rectangle(
-                    (col, row), 1, 1, edgecolor="black", facecolor=tile_color
-                )
-                ax.add_patch(rect)
-
-        plt.xlim(0, ncols)
-        plt.ylim(0, nrows)
-        plt.gca().invert_yaxis()  # Invert y-axis to match array layout
-        plt.axis("off")  # Turn off the axis
-        plt.show()
-
-    except Exception as e:
-        print(f"Failed to read the file: {e}")
-
-
-def main():
-    file_path = sys.argv[1]
-    plot_maze(file_path)
-
-
-
-if __name__ == "__main__":
+import numpy as np
+import matplotlib.pyplot as plt
+from matplotlib.animation import FuncAnimation
+from matplotlib.patches import Rectangle
+import struct
+import sys
+
+# Header of an expansion trace written by Project1 --trace: magic, rows, cols, start x, start y, goal x, goal y,
+# followed by the x, y of every expanded node as little-endian int32 pairs
+TRACE_HEADER = struct.Struct("<4s6i")
+TRACE_MAGIC = b"TRC1"
+# Number of frames the replay is split into
+TRACE_FRAMES = 200
+
+# Size of maps whose header is only "start_x start_y goal_x goal_y", as in Project1
+DEFAULT_ROWS = 30
+DEFAULT_COLS = 50
+
+
+def load_maze(file_path):
+    # Reads a map in Project1's text format, which is also what Project1 --map writes: a header of either
+    # "rows cols start_x start_y goal_x goal_y" or "start_x start_y goal_x goal_y" for a 30x50 map, followed
+    # by the rows. Older outputs instead start with the four lines of the search result, then the 30x50 map
+    with open(file_path, "r") as file:
+        lines = file.read().splitlines()
+    header = lines[0].split()
+    rows, cols, first = DEFAULT_ROWS, DEFAULT_COLS, 1
+    if len(header) == 6:
+        rows, cols = int(header[0]), int(header[1])
+    elif len(header) == 1:
+        first = 4
+    elif len(header) != 4:
+        raise ValueError(f"{file_path} has a malformed header")
+    cells = " ".join(lines[first:]).split()
+    if len(cells) < rows * cols:
+        raise ValueError(f"the map in {file_path} is smaller than {rows}x{cols}")
+    return np.array(cells[: rows * cols], dtype=float).reshape(rows, cols)
+
+
+def plot_maze(file_path):
+    try:
+        # Load the maze from the .txt file
+        maze = load_maze(file_path)
+
+        # Initialize the plot
+        fig, ax = plt.subplots(figsize=(12, 7))
+        nrows, ncols = maze.shape
+
+        # Define colors for each tile type
+        colors = {0: "white", 1: "black", 2: "red", 3: "white", 4: "yellow", 5: "green"}
+
+        # Plot each tile
+        for row in range(nrows):
+            for col in range(ncols):
+                tile_color = colors.get(
+                    maze[row, col], "white"
+                )  # Default to white if unknown
+                rect = Rectangle(
+                    (col, row), 1, 1, edgecolor="black", facecolor=tile_color
+                )
+                ax.add_patch(rect)
+
+        plt.xlim(0, ncols)
+        plt.ylim(0, nrows)
+        plt.gca().invert_yaxis()  # Invert y-axis to match array layout
+        plt.axis("off")  # Turn off the axis
+        plt.show()
+
+    except Exception as e:
+        print(f"Failed to read the file: {e}")
+
+
+def read_trace(trace_path):
+    with open(trace_path, "rb") as file:
+        magic, rows, cols, start_x, start_y, goal_x, goal_y = TRACE_HEADER.unpack(file.read(TRACE_HEADER.size))
+        if magic != TRACE_MAGIC:
+            raise ValueError(f"{trace_path} is not an expansion trace")
+        expanded = np.fromfile(file, dtype="<i4").reshape(-1, 2)
+    return rows, cols, (start_x, start_y), (goal_x, goal_y), expanded
+
+
+def replay_trace(file_path, trace_path):
+    try:
+        rows, cols, start, goal, expanded = read_trace(trace_path)
+        maze = load_maze(file_path)
+        if maze.shape != (rows, cols):
+            raise ValueError(f"the trace is for a {rows}x{cols} map, {file_path} is {maze.shape[0]}x{maze.shape[1]}")
+
+        fig, ax = plt.subplots(figsize=(12, 7))
+        ax.imshow(maze == 1, cmap="Greys", interpolation="nearest")
+
+        # Expansion order of every cell, hidden until the replay reaches it
+        order = np.full((rows, cols), np.nan)
+        image = ax.imshow(order, cmap="viridis", vmin=0, vmax=max(len(expanded), 1), interpolation="nearest")
+        # Trace y grows upwards while the maze rows run top to bottom
+        ax.plot(start[0], rows - 1 - start[1], "o", color="green")
+        ax.plot(goal[0], rows - 1 - goal[1], "o", color="red")
+        ax.set_axis_off()
+
+        step = max(1, -(-len(expanded) // TRACE_FRAMES))
+
+        def update(frame):
+            first, last = frame * step, min((frame + 1) * step, len(expanded))
+            xs, ys = expanded[first:last, 0], expanded[first:last, 1]
+            order[rows - 1 - ys, xs] = np.arange(first, last)
+            image.set_data(order)
+            ax.set_title(f"{last} of {len(expanded)} nodes expanded")
+            return (image,)
+
+        frames = -(-len(expanded) // step)
+        animation = FuncAnimation(fig, update, frames=frames, interval=30, repeat=False)
+        plt.show()
+        return animation
+
+    except Exception as e:
+        print(f"Failed to replay the trace: {e}")
+
+
+def main():
+    file_path = sys.argv[1]
+    if len(sys.argv) > 2:
+        replay_trace(file_path, sys.argv[2])
+    else:
+        plot_maze(file_path)
+
+
+
+if __name__ == "__main__":
     main()
\ No newline at end of file